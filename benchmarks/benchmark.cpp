@@ -0,0 +1,319 @@
+/* Benchmark of TrapezoidalMap construction and point queries.
+ *
+ * Build from the root of the repository with optimizations and without
+ * assertions, e.g.
+ *   g++ -std=c++17 -O2 -DNDEBUG -pthread -Isrc benchmarks/benchmark.cpp \
+ *       $(find src -name '*.cpp' ! -name main.cpp) -o benchmark
+ * and run
+ *   ./benchmark [--workloads convex,star,comb,spiral,random]
+ *               [--sizes 10,100,1000,10000,100000]
+ *               [--orders input,shuffled,brio] [--queries COUNT]
+ *               [--repeat COUNT] [--seed SEED]
+ *
+ * Each measurement is printed as a JSON object on a separate line:
+ * workload, size (number of vertices), order of insertion of edges
+ * ("input" order of the contour, "shuffled" or "brio"), best of repeated
+ * construction times, peak bytes requested by the arena of the map,
+ * peak resident set size of the process, numbers of nodes & trapezoids
+ * of the search graph and throughputs of batched Locator queries
+ * and of Node::search queries for uniformly distributed points
+ * in the bounding box of the contour. */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "arena.h"
+#include "bounding_box.h"
+#include "locator.h"
+#include "point.h"
+#include "trapezoidal_map.h"
+
+static const double PI = 3.14159265358979323846;
+
+typedef std::vector<Point> Contour;
+
+// Regular polygon.
+static Contour generate_convex(std::size_t size, std::mt19937_64&) {
+  Contour result;
+  for (std::size_t index = 0; index < size; ++index) {
+    double angle = 2. * PI * index / size;
+    result.push_back(Point(std::cos(angle), std::sin(angle)));
+  }
+  return result;
+}
+
+// Polygon with vertices alternating between 2 radii.
+static Contour generate_star(std::size_t size, std::mt19937_64&) {
+  Contour result;
+  for (std::size_t index = 0; index < size; ++index) {
+    double angle = 2. * PI * index / size;
+    double radius = index % 2 ? 0.5 : 1.;
+    result.push_back(Point(radius * std::cos(angle), radius * std::sin(angle)));
+  }
+  return result;
+}
+
+// Trapezoidal teeth on top of a rectangular base.
+static Contour generate_comb(std::size_t size, std::mt19937_64&) {
+  std::size_t teeth = std::max<std::size_t>((size - 3) / 3, 1);
+  Contour result;
+  for (std::size_t tooth = 0; tooth < teeth; ++tooth) {
+    result.push_back(Point(3. * tooth, 0.));
+    result.push_back(Point(3. * tooth + 1., 10.));
+    result.push_back(Point(3. * tooth + 2., 10.));
+  }
+  result.push_back(Point(3. * teeth, 0.));
+  result.push_back(Point(3. * teeth, -1.));
+  result.push_back(Point(0., -1.));
+  return result;
+}
+
+/* Band between 2 arms of the Archimedean spiral going outwards
+ * along the outer arm and back along the inner one. */
+static Contour generate_spiral(std::size_t size, std::mt19937_64&) {
+  std::size_t arm_size = std::max<std::size_t>(size / 2, 2);
+  double turn_size = std::max(16., std::sqrt(static_cast<double>(arm_size)));
+  Contour result;
+  for (std::size_t index = 0; index < arm_size; ++index) {
+    double angle = 2. * PI * index / turn_size;
+    double radius = 1. + angle / (2. * PI);
+    result.push_back(Point(radius * std::cos(angle), radius * std::sin(angle)));
+  }
+  for (std::size_t index = arm_size; index-- > 0;) {
+    double angle = 2. * PI * index / turn_size;
+    double radius = 0.5 + angle / (2. * PI);
+    result.push_back(Point(radius * std::cos(angle), radius * std::sin(angle)));
+  }
+  return result;
+}
+
+// Star-shaped polygon with random angles & radii of vertices.
+static Contour generate_random(std::size_t size, std::mt19937_64& generator) {
+  std::uniform_real_distribution<double> angles(0., 2. * PI);
+  std::uniform_real_distribution<double> radii(0.5, 1.);
+  std::vector<double> vertices_angles;
+  for (std::size_t index = 0; index < size; ++index)
+    vertices_angles.push_back(angles(generator));
+  std::sort(vertices_angles.begin(), vertices_angles.end());
+  vertices_angles.erase(
+      std::unique(vertices_angles.begin(), vertices_angles.end()),
+      vertices_angles.end());
+  Contour result;
+  for (double angle : vertices_angles) {
+    double radius = radii(generator);
+    result.push_back(Point(radius * std::cos(angle), radius * std::sin(angle)));
+  }
+  return result;
+}
+
+struct Order {
+  const char* name;
+  TrapezoidalMap::Order value;
+};
+
+static const Order ORDERS[] = {{"input", TrapezoidalMap::Order_Input},
+                               {"shuffled", TrapezoidalMap::Order_Shuffle},
+                               {"brio", TrapezoidalMap::Order_Brio}};
+
+struct Workload {
+  const char* name;
+  Contour (*generate)(std::size_t, std::mt19937_64&);
+};
+
+static const Workload WORKLOADS[] = {{"convex", generate_convex},
+                                     {"star", generate_star},
+                                     {"comb", generate_comb},
+                                     {"spiral", generate_spiral},
+                                     {"random", generate_random}};
+
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+// Upstream resource of the arena tracking the peak of requested bytes.
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  std::size_t peak_bytes() const { return _peak_bytes; }
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    _bytes += bytes;
+    _peak_bytes = std::max(_peak_bytes, _bytes);
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* pointer, std::size_t bytes,
+                     std::size_t alignment) override {
+    _bytes -= bytes;
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+  }
+
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::size_t _bytes = 0;
+  std::size_t _peak_bytes = 0;
+};
+#endif
+
+// Peak resident set size of the process in bytes, 0 if unknown.
+static std::size_t max_rss_bytes() {
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+  return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+static std::vector<std::string> split(const std::string& value) {
+  std::vector<std::string> result;
+  std::size_t start = 0;
+  for (;;) {
+    std::size_t end = value.find(',', start);
+    result.push_back(value.substr(start, end - start));
+    if (end == std::string::npos) return result;
+    start = end + 1;
+  }
+}
+
+static void benchmark(const Workload& workload, std::size_t size,
+                      const Order& order, std::size_t queries_count,
+                      std::size_t repeat, std::mt19937_64& generator) {
+  const Contour contour = workload.generate(size, generator);
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+  // Declared before the map to outlive it.
+  CountingResource resource;
+#endif
+  std::unique_ptr<TrapezoidalMap> map;
+  double build_seconds = 0.;
+  for (std::size_t attempt = 0; attempt < repeat; ++attempt) {
+    map.reset();
+    auto start = std::chrono::steady_clock::now();
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+    map.reset(new TrapezoidalMap(contour, order.value, &resource));
+#else
+    map.reset(new TrapezoidalMap(contour, order.value));
+#endif
+    double seconds = seconds_since(start);
+    build_seconds = attempt == 0 ? seconds : std::min(build_seconds, seconds);
+  }
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+  std::size_t arena_peak_bytes = resource.peak_bytes();
+#else
+  std::size_t arena_peak_bytes = 0;
+#endif
+
+  BoundingBox box;
+  for (const Point& point : contour) box.add(point);
+  std::uniform_real_distribution<double> xs(box.lower.x, box.upper.x);
+  std::uniform_real_distribution<double> ys(box.lower.y, box.upper.y);
+  std::vector<double> coordinates;
+  coordinates.reserve(2 * queries_count);
+  for (std::size_t index = 0; index < queries_count; ++index) {
+    coordinates.push_back(xs(generator));
+    coordinates.push_back(ys(generator));
+  }
+  const Locator& locator = map->locator();
+  std::vector<std::int64_t> indices(queries_count);
+  std::vector<std::uint8_t> kinds(queries_count);
+  auto start = std::chrono::steady_clock::now();
+  locator.locate(coordinates.data(), queries_count, indices.data(),
+                 kinds.data());
+  double locate_seconds = seconds_since(start);
+  std::size_t checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (std::size_t index = 0; index < queries_count; ++index)
+    checksum += map->root()
+                    .search(Point(coordinates[2 * index],
+                                  coordinates[2 * index + 1]))
+                    ->type;
+  double search_seconds = seconds_since(start);
+
+  std::printf(
+      "{\"workload\": \"%s\", \"size\": %zu, \"order\": \"%s\", "
+      "\"build_seconds\": %.9g, \"arena_peak_bytes\": %zu, "
+      "\"max_rss_bytes\": %zu, \"nodes\": %zu, \"trapezoids\": %zu, "
+      "\"queries\": %zu, \"locate_queries_per_second\": %.9g, "
+      "\"search_queries_per_second\": %.9g, \"checksum\": %zu}\n",
+      workload.name, contour.size(), order.name,
+      build_seconds, arena_peak_bytes, max_rss_bytes(),
+      map->root().collect_nodes().size(), locator.trapezoids().size(),
+      queries_count, queries_count / std::max(locate_seconds, 1e-9),
+      queries_count / std::max(search_seconds, 1e-9), checksum);
+  std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> workloads_names = {"convex", "star", "comb",
+                                              "spiral", "random"};
+  std::vector<std::size_t> sizes = {10, 100, 1000, 10000, 100000};
+  std::vector<std::string> orders = {"input", "shuffled", "brio"};
+  std::size_t queries_count = 100000;
+  std::size_t repeat = 3;
+  unsigned long long seed = 0;
+  for (int index = 1; index + 1 < argc; index += 2) {
+    std::string name = argv[index], value = argv[index + 1];
+    if (name == "--workloads")
+      workloads_names = split(value);
+    else if (name == "--sizes") {
+      sizes.clear();
+      for (const std::string& size : split(value))
+        sizes.push_back(std::strtoull(size.c_str(), nullptr, 10));
+    } else if (name == "--orders")
+      orders = split(value);
+    else if (name == "--queries")
+      queries_count = std::strtoull(value.c_str(), nullptr, 10);
+    else if (name == "--repeat")
+      repeat = std::max<std::size_t>(
+          std::strtoull(value.c_str(), nullptr, 10), 1);
+    else if (name == "--seed")
+      seed = std::strtoull(value.c_str(), nullptr, 10);
+    else {
+      std::fprintf(stderr, "Unknown option: %s\n", name.c_str());
+      return 1;
+    }
+  }
+  for (const std::string& name : workloads_names) {
+    const Workload* workload = nullptr;
+    for (const Workload& candidate : WORKLOADS)
+      if (name == candidate.name) workload = &candidate;
+    if (workload == nullptr) {
+      std::fprintf(stderr, "Unknown workload: %s\n", name.c_str());
+      return 1;
+    }
+    for (std::size_t size : sizes)
+      for (const std::string& order_name : orders) {
+        const Order* order = nullptr;
+        for (const Order& candidate : ORDERS)
+          if (order_name == candidate.name) order = &candidate;
+        if (order == nullptr) {
+          std::fprintf(stderr, "Unknown order: %s\n", order_name.c_str());
+          return 1;
+        }
+        std::mt19937_64 generator(seed);
+        benchmark(*workload, size, *order, queries_count, repeat, generator);
+      }
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+"""
+Benchmark of `_seidel` binding construction and point queries.
+
+Run from the root of the repository after installation, e.g.
+    python benchmarks/benchmark.py --sizes 10,100,1000,10000
+Each measurement is printed as a JSON object on a separate line
+with the same fields as the ones of the native benchmark
+(`benchmarks/benchmark.cpp`) for the same workloads,
+so the binding overhead is the difference between them.
+Per-point queries go through `root.search_point` one call at a time,
+batched ones through a single `locate` call.
+"""
+import argparse
+import json
+import math
+import random
+import sys
+import time
+from typing import (Callable,
+                    Dict,
+                    List)
+
+import numpy
+from _seidel import (ORDER_BRIO,
+                     ORDER_INPUT,
+                     ORDER_SHUFFLE,
+                     Point,
+                     TrapezoidalMap)
+
+Contour = List[Point]
+
+
+def generate_convex(size: int, generator: random.Random) -> Contour:
+    return [Point(math.cos(2 * math.pi * index / size),
+                  math.sin(2 * math.pi * index / size))
+            for index in range(size)]
+
+
+def generate_star(size: int, generator: random.Random) -> Contour:
+    return [Point(radius * math.cos(2 * math.pi * index / size),
+                  radius * math.sin(2 * math.pi * index / size))
+            for index, radius in ((index, 0.5 if index % 2 else 1.)
+                                  for index in range(size))]
+
+
+def generate_comb(size: int, generator: random.Random) -> Contour:
+    teeth = max((size - 3) // 3, 1)
+    result = []
+    for tooth in range(teeth):
+        result += [Point(3. * tooth, 0.), Point(3. * tooth + 1., 10.),
+                   Point(3. * tooth + 2., 10.)]
+    return result + [Point(3. * teeth, 0.), Point(3. * teeth, -1.),
+                     Point(0., -1.)]
+
+
+def generate_spiral(size: int, generator: random.Random) -> Contour:
+    arm_size = max(size // 2, 2)
+    turn_size = max(16., math.sqrt(arm_size))
+
+    def to_point(index: int, offset: float) -> Point:
+        angle = 2 * math.pi * index / turn_size
+        radius = offset + angle / (2 * math.pi)
+        return Point(radius * math.cos(angle), radius * math.sin(angle))
+
+    return ([to_point(index, 1.) for index in range(arm_size)]
+            + [to_point(index, 0.5) for index in reversed(range(arm_size))])
+
+
+def generate_random(size: int, generator: random.Random) -> Contour:
+    angles = sorted({generator.uniform(0., 2 * math.pi)
+                     for _ in range(size)})
+    result = []
+    for angle in angles:
+        radius = generator.uniform(0.5, 1.)
+        result.append(Point(radius * math.cos(angle),
+                            radius * math.sin(angle)))
+    return result
+
+
+ORDERS = {
+    'input': ORDER_INPUT,
+    'shuffled': ORDER_SHUFFLE,
+    'brio': ORDER_BRIO,
+}  # type: Dict[str, int]
+
+WORKLOADS = {
+    'convex': generate_convex,
+    'star': generate_star,
+    'comb': generate_comb,
+    'spiral': generate_spiral,
+    'random': generate_random,
+}  # type: Dict[str, Callable[[int, random.Random], Contour]]
+
+
+def benchmark(workload: str,
+              size: int,
+              order: str,
+              queries_count: int,
+              repeat: int,
+              generator: random.Random) -> Dict[str, object]:
+    contour = WORKLOADS[workload](size, generator)
+    build_seconds = math.inf
+    for _ in range(repeat):
+        start = time.perf_counter()
+        trapezoidal_map = TrapezoidalMap(contour, ORDERS[order])
+        build_seconds = min(build_seconds, time.perf_counter() - start)
+    xs, ys = [point.x for point in contour], [point.y for point in contour]
+    points = numpy.array([(generator.uniform(min(xs), max(xs)),
+                           generator.uniform(min(ys), max(ys)))
+                          for _ in range(queries_count)],
+                         dtype=float).reshape(-1, 2)
+    start = time.perf_counter()
+    trapezoidal_map.locate(points)
+    locate_seconds = time.perf_counter() - start
+    queries = [Point(x, y) for x, y in points.tolist()]
+    root = trapezoidal_map.root
+    start = time.perf_counter()
+    for query in queries:
+        root.search_point(query)
+    search_seconds = time.perf_counter() - start
+    return {'workload': workload,
+            'size': len(contour),
+            'order': order,
+            'build_seconds': build_seconds,
+            'trapezoids': len(trapezoidal_map),
+            'queries': queries_count,
+            'locate_queries_per_second':
+                queries_count / max(locate_seconds, 1e-9),
+            'search_queries_per_second':
+                queries_count / max(search_seconds, 1e-9)}
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.strip())
+    parser.add_argument('--workloads',
+                        default=','.join(WORKLOADS))
+    parser.add_argument('--sizes',
+                        default='10,100,1000,10000')
+    parser.add_argument('--orders',
+                        default=','.join(ORDERS))
+    parser.add_argument('--queries',
+                        type=int,
+                        default=10000)
+    parser.add_argument('--repeat',
+                        type=int,
+                        default=3)
+    parser.add_argument('--seed',
+                        type=int,
+                        default=0)
+    args = parser.parse_args()
+    for workload in args.workloads.split(','):
+        if workload not in WORKLOADS:
+            parser.error('Unknown workload: {}'.format(workload))
+        for size in map(int, args.sizes.split(',')):
+            for order in args.orders.split(','):
+                if order not in ORDERS:
+                    parser.error('Unknown order: {}'.format(order))
+                result = benchmark(workload, size, order,
+                                   args.queries, max(args.repeat, 1),
+                                   random.Random(args.seed))
+                sys.stdout.write(json.dumps(result) + '\n')
+                sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,4 +1,5 @@
 import math
+from fractions import Fraction
 
 from reprit.base import generate_repr
 
@@ -30,7 +31,10 @@ class Edge:
             return math.copysign(math.inf, difference.x * difference.y)
 
     def orientation_with(self, point: Point) -> int:
-        cross_z = (point - self.left).cross_z(self.right - self.left)
+        # Coordinates are converted to fractions, so the sign is exact.
+        left, right, point = (Point(Fraction(point_.x), Fraction(point_.y))
+                              for point_ in (self.left, self.right, point))
+        cross_z = (point - left).cross_z(right - left)
         return (1
                 if cross_z > 0
                 else (-1
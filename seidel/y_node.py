@@ -40,30 +40,16 @@ class YNode(Node):
         new_child._add_parent(self)
 
     def search_edge(self, edge: Edge) -> Optional[Trapezoid]:
-        if edge.left is self.edge.left:
-            # Coinciding left edge points.
-            if edge.slope == self.edge.slope:
-                return None
-            if edge.slope > self.edge.slope:
-                return self.above.search_edge(edge)
-            else:
-                return self.below.search_edge(edge)
-        elif edge.right is self.edge.right:
-            # Coinciding right edge points.
-            if edge.slope == self.edge.slope:
-                return None
-            elif edge.slope > self.edge.slope:
-                return self.below.search_edge(edge)
-            else:
-                return self.above.search_edge(edge)
+        # With coinciding left edge points the edge is compared
+        # by its right point, which is the same as comparison of slopes.
+        orientation = self.edge.orientation_with(
+                edge.right if edge.left is self.edge.left else edge.left)
+        if orientation < 0:
+            return self.above.search_edge(edge)
+        elif orientation > 0:
+            return self.below.search_edge(edge)
         else:
-            orientation = self.edge.orientation_with(edge.left)
-            if orientation < 0:
-                return self.above.search_edge(edge)
-            elif orientation > 0:
-                return self.below.search_edge(edge)
-            else:
-                return None
+            return None
 
     def search_point(self, point: Point) -> 'Node':
         orient = self.edge.orientation_with(point)
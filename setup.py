@@ -47,10 +47,10 @@ class BuildExt(build_ext):
     """A custom build extension for adding compiler-specific options."""
     compile_args = defaultdict(list,
                                {'msvc': ['/EHsc'],
-                                'unix': []})
+                                'unix': ['-pthread']})
     link_args = defaultdict(list,
                             {'msvc': [],
-                             'unix': []})
+                             'unix': ['-pthread']})
 
     if sys.platform == 'darwin':
         darwin_args = ['-stdlib=libc++', '-mmacosx-version-min=10.7']
@@ -0,0 +1,88 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+static const std::size_t MIN_BLOCK_SIZE = 4096;
+static const std::size_t MAX_BLOCK_SIZE = 1 << 20;
+static const std::size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+Arena::Arena(std::pmr::memory_resource* upstream)
+    : _upstream(upstream), _cursor(nullptr), _available(0),
+      _allocated_bytes(0) {
+  assert(upstream != nullptr && "Null upstream memory resource");
+}
+#else
+Arena::Arena() : _cursor(nullptr), _available(0), _allocated_bytes(0) {}
+#endif
+
+Arena::~Arena() {
+  for (const Block& block : _blocks) {
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+    _upstream->deallocate(block.memory, block.size, BLOCK_ALIGNMENT);
+#else
+    ::operator delete(block.memory);
+#endif
+  }
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+  assert(alignment <= BLOCK_ALIGNMENT && "Unsupported alignment");
+  // Chunks are never smaller than a free list link, so they can be reused.
+  size = std::max(size, sizeof(FreeChunk));
+  for (FreeList& free_list : _free_lists)
+    if (free_list.size == size && free_list.head != nullptr &&
+        reinterpret_cast<std::uintptr_t>(free_list.head) % alignment == 0) {
+      FreeChunk* chunk = free_list.head;
+      free_list.head = chunk->next;
+      return chunk;
+    }
+  std::size_t padding =
+      (alignment - reinterpret_cast<std::uintptr_t>(_cursor) % alignment) %
+      alignment;
+  if (_cursor == nullptr || padding + size > _available) {
+    add_block(size);
+    padding = 0;
+  }
+  void* result = _cursor + padding;
+  _cursor += padding + size;
+  _available -= padding + size;
+  return result;
+}
+
+void Arena::reserve(std::size_t size) {
+  if (_cursor == nullptr || size > _available) add_block(size);
+}
+
+void Arena::deallocate(void* pointer, std::size_t size) {
+  assert(pointer != nullptr && "Null pointer");
+  size = std::max(size, sizeof(FreeChunk));
+  FreeChunk* chunk = static_cast<FreeChunk*>(pointer);
+  for (FreeList& free_list : _free_lists)
+    if (free_list.size == size) {
+      chunk->next = free_list.head;
+      free_list.head = chunk;
+      return;
+    }
+  chunk->next = nullptr;
+  _free_lists.push_back(FreeList{size, chunk});
+}
+
+void Arena::add_block(std::size_t min_size) {
+  // Blocks grow geometrically to amortize upstream allocations.
+  std::size_t size =
+      _blocks.empty() ? MIN_BLOCK_SIZE
+                      : std::min(2 * _blocks.back().size, MAX_BLOCK_SIZE);
+  size = std::max(size, min_size);
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+  void* memory = _upstream->allocate(size, BLOCK_ALIGNMENT);
+#else
+  void* memory = ::operator new(size);
+#endif
+  _blocks.push_back(Block{memory, size});
+  _cursor = static_cast<char*>(memory);
+  _available = size;
+  _allocated_bytes += size;
+}
@@ -0,0 +1,89 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define ARENA_HAS_MEMORY_RESOURCE
+#endif
+#endif
+
+/* Region based allocator: objects are bump-allocated from large blocks
+ * which are all released at once when the Arena is destroyed.
+ * Memory of individual objects can be handed back with deallocate
+ * to be reused by the following allocations of the same size.
+ * Destructors are never called by the Arena, so its owner is responsible
+ * for destroying objects which hold any other resources.
+ * Blocks are requested from the upstream memory resource if it is supported
+ * and from the global operator new otherwise. */
+class Arena {
+ public:
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+  explicit Arena(std::pmr::memory_resource* upstream =
+                     std::pmr::get_default_resource());
+#else
+  Arena();
+#endif
+
+  ~Arena();
+
+  void* allocate(std::size_t size, std::size_t alignment);
+
+  // Return memory of an object to be reused by allocations of the same size.
+  void deallocate(void* pointer, std::size_t size);
+
+  // Make the following allocations of the total size fit in a single block.
+  void reserve(std::size_t size);
+
+  template <class Object, class... Args>
+  Object* create(Args&&... args) {
+    return new (allocate(sizeof(Object), alignof(Object)))
+        Object(std::forward<Args>(args)...);
+  }
+
+  template <class Object>
+  void destroy(Object* object) {
+    object->~Object();
+    deallocate(object, sizeof(Object));
+  }
+
+  // Total size of blocks requested from upstream.
+  std::size_t allocated_bytes() const { return _allocated_bytes; }
+
+  Arena(const Arena& other) = delete;
+  Arena& operator=(const Arena& other) = delete;
+
+ private:
+  struct Block {
+    void* memory;
+    std::size_t size;
+  };
+
+  // Intrusive singly linked list of deallocated chunks of the same size.
+  struct FreeChunk {
+    FreeChunk* next;
+  };
+
+  struct FreeList {
+    std::size_t size;
+    FreeChunk* head;
+  };
+
+  void add_block(std::size_t min_size);
+
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+  std::pmr::memory_resource* _upstream;
+#endif
+  std::vector<Block> _blocks;
+  std::vector<FreeList> _free_lists;
+  char* _cursor;
+  std::size_t _available;
+  std::size_t _allocated_bytes;
+};
+
+#endif
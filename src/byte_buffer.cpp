@@ -0,0 +1,50 @@
+#include "byte_buffer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+void ByteWriter::write(std::uint64_t value, std::size_t size) {
+  for (std::size_t byte = 0; byte < size; ++byte)
+    _bytes.push_back(static_cast<char>((value >> (8 * byte)) & 0xFF));
+}
+
+void ByteWriter::write_double(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  write(bits, sizeof(bits));
+}
+
+ByteReader::ByteReader(const char* data, std::size_t size)
+    : _cursor(data), _end(data + size) {}
+
+std::uint64_t ByteReader::read(std::size_t size) {
+  if (static_cast<std::size_t>(_end - _cursor) < size)
+    throw std::runtime_error("Data is truncated.");
+  std::uint64_t result = 0;
+  for (std::size_t byte = 0; byte < size; ++byte)
+    result |= static_cast<std::uint64_t>(
+                  static_cast<unsigned char>(_cursor[byte]))
+              << (8 * byte);
+  _cursor += size;
+  return result;
+}
+
+double ByteReader::read_double() {
+  std::uint64_t bits = read(8);
+  double result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+std::size_t ByteReader::read_count(std::size_t record_size) {
+  std::uint64_t result = read(8);
+  if (result > static_cast<std::size_t>(_end - _cursor) / record_size)
+    throw std::runtime_error("Data is truncated.");
+  return static_cast<std::size_t>(result);
+}
+
+std::uint32_t ByteReader::read_index(std::size_t limit) {
+  std::uint64_t result = read(4);
+  if (result >= limit) throw std::runtime_error("Data is corrupted.");
+  return static_cast<std::uint32_t>(result);
+}
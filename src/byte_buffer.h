@@ -0,0 +1,44 @@
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Writer & reader of binary formats of the search graph.
+ * Values are written byte by byte in little-endian order,
+ * so the formats do not depend on the platform. */
+class ByteWriter {
+ public:
+  void write(std::uint64_t value, std::size_t size);
+  void write_double(double value);
+
+  std::vector<char>& bytes() { return _bytes; }
+
+ private:
+  std::vector<char> _bytes;
+};
+
+/* Reader throws std::runtime_error instead of reading past the end
+ * of the data or returning invalid indices. */
+class ByteReader {
+ public:
+  ByteReader(const char* data, std::size_t size);
+
+  bool at_end() const { return _cursor == _end; }
+
+  std::uint64_t read(std::size_t size);
+  double read_double();
+
+  // Read count of records of the specified size which should fit the data.
+  std::size_t read_count(std::size_t record_size);
+
+  // Read 32-bit index which should be less than the limit.
+  std::uint32_t read_index(std::size_t limit);
+
+ private:
+  const char* _cursor;
+  const char* _end;
+};
+
+#endif
@@ -2,6 +2,8 @@
 
 #include <cassert>
 
+#include "predicates.h"
+
 Edge::Edge(const Point* left_, const Point* right_)
     : left(left_), right(right_) {
   assert(left != nullptr && "Null left endpoint");
@@ -10,8 +12,22 @@ Edge::Edge(const Point* left_, const Point* right_)
 }
 
 int Edge::get_point_orientation(const Point& xy) const {
-  double cross_z = (xy - *left).cross_z(*right - *left);
-  return (cross_z > 0.) ? +1 : ((cross_z < 0.) ? -1 : 0);
+  return orientation(xy, *left, *right);
+}
+
+bool Edge::intersects(const Edge& other) const {
+  int other_left = get_point_orientation(*other.left);
+  int other_right = get_point_orientation(*other.right);
+  if (other_left * other_right > 0) return false;
+  int this_left = other.get_point_orientation(*left);
+  int this_right = other.get_point_orientation(*right);
+  if (this_left * this_right > 0) return false;
+  // Collinear edges intersect unless they meet at an endpoint at most.
+  if (other_left == 0 && other_right == 0)
+    return other.right->is_right_of(*left) && right->is_right_of(*other.left);
+  // Other edges meet at a single point, which may only be a shared endpoint.
+  return !(*left == *other.left || *left == *other.right ||
+           *right == *other.left || *right == *other.right);
 }
 
 double Edge::get_slope() const {
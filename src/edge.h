@@ -12,9 +12,15 @@ struct Edge {
   Edge(const Point* left_, const Point* right_);
   virtual ~Edge() = default;
 
-  // Return -1 if point to left of edge, 0 if on edge, +1 if to right.
+  /* Return -1 if point to left of edge, 0 if on edge, +1 if to right,
+   * exactly for all points (see orientation). */
   int get_point_orientation(const Point& xy) const;
 
+  /* Return true if the edge has points in common with the other one
+   * besides their shared endpoints, i.e. they cross, overlap or
+   * an endpoint of one lies in the interior of the other. */
+  bool intersects(const Edge& other) const;
+
   // Return slope of edge, even if vertical (divide by zero is OK here).
   double get_slope() const;
 
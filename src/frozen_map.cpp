@@ -0,0 +1,497 @@
+#include "frozen_map.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "predicates.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define FROZEN_MAP_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(FrozenMap::Record) == 16, "Frozen node should be compact");
+
+// Header of the image followed by sections of nodes, xs, ys,
+// edges lefts, edges rights and erased flags in this order.
+struct ImageHeader {
+  char magic[8];
+  std::uint32_t version;
+  // Reads differently on platforms with the other byte order.
+  std::uint32_t byte_order;
+  std::uint64_t nodes_count;
+  std::uint64_t points_count;
+  std::uint64_t edges_count;
+  std::uint64_t trapezoids_count;
+  std::uint64_t has_erased;
+};
+
+static const char IMAGE_MAGIC[8] = {'S', 'E', 'I', 'D', 'E', 'L', 'F', 'M'};
+static const std::uint32_t IMAGE_VERSION = 1;
+static const std::uint32_t IMAGE_BYTE_ORDER = 0x01020304;
+static const std::size_t IMAGE_ALIGNMENT = 8;
+
+// Offsets of sections in the image described by the header.
+struct ImageLayout {
+  explicit ImageLayout(const ImageHeader& header) {
+    nodes = align(sizeof(ImageHeader));
+    xs = align(nodes + header.nodes_count * sizeof(FrozenMap::Record));
+    ys = align(xs + header.points_count * sizeof(double));
+    edges_lefts = align(ys + header.points_count * sizeof(double));
+    edges_rights =
+        align(edges_lefts + header.edges_count * sizeof(std::uint32_t));
+    erased = align(edges_rights + header.edges_count * sizeof(std::uint32_t));
+    size = align(erased + (header.has_erased ? header.nodes_count : 0));
+  }
+
+  static std::size_t align(std::size_t offset) {
+    return (offset + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+  }
+
+  std::size_t nodes, xs, ys, edges_lefts, edges_rights, erased, size;
+};
+
+template <class Value>
+static void copy_section(char* image, std::size_t offset,
+                         const std::vector<Value>& values) {
+  if (!values.empty())
+    std::memcpy(image + offset, values.data(), values.size() * sizeof(Value));
+}
+
+static std::uint32_t to_index(std::size_t value) {
+  if (value > std::numeric_limits<std::uint32_t>::max())
+    throw std::length_error("Search graph is too large to be frozen.");
+  return static_cast<std::uint32_t>(value);
+}
+
+FrozenMap::FrozenMap(const Node& root) {
+  const Locator locator(root);
+  std::vector<double> xs, ys;
+  std::vector<std::uint32_t> edges_lefts, edges_rights;
+  std::unordered_map<const Point*, std::uint32_t> points_indices;
+  for (const Point* point : locator.points()) {
+    points_indices.emplace(point, to_index(xs.size()));
+    xs.push_back(point->x);
+    ys.push_back(point->y);
+  }
+  auto point_index = [&](const Point* point) {
+    auto position = points_indices.find(point);
+    if (position != points_indices.end()) return position->second;
+    std::uint32_t result = to_index(xs.size());
+    points_indices.emplace(point, result);
+    xs.push_back(point->x);
+    ys.push_back(point->y);
+    return result;
+  };
+  std::unordered_map<const Edge*, std::uint32_t> edges_indices;
+  for (const Edge* edge : locator.edges()) {
+    edges_indices.emplace(edge, to_index(edges_lefts.size()));
+    edges_lefts.push_back(point_index(edge->left));
+    edges_rights.push_back(point_index(edge->right));
+  }
+  std::unordered_map<const Trapezoid*, std::uint32_t> trapezoids_indices;
+  for (const Trapezoid* trapezoid : locator.trapezoids())
+    trapezoids_indices.emplace(trapezoid,
+                               to_index(trapezoids_indices.size()));
+
+  const std::vector<const Node*> nodes = root.collect_nodes();
+  std::unordered_map<const Node*, std::uint32_t> nodes_indices;
+  for (const Node* node : nodes)
+    nodes_indices.emplace(node, to_index(nodes_indices.size()));
+  std::vector<Record> records;
+  std::vector<std::uint8_t> erased;
+  records.reserve(nodes.size());
+  for (const Node* node : nodes) {
+    Record frozen = {static_cast<std::uint32_t>(node->type), 0, 0, 0};
+    switch (node->type) {
+      case Node::Type_XNode:
+        frozen.index = points_indices.at(node->data.xnode.point);
+        frozen.first = nodes_indices.at(node->data.xnode.left);
+        frozen.second = nodes_indices.at(node->data.xnode.right);
+        break;
+      case Node::Type_YNode:
+        frozen.index = edges_indices.at(node->data.ynode.edge);
+        frozen.first = nodes_indices.at(node->data.ynode.below);
+        frozen.second = nodes_indices.at(node->data.ynode.above);
+        break;
+      case Node::Type_TrapezoidNode:
+        frozen.index = trapezoids_indices.at(node->data.trapezoid);
+        break;
+    }
+    if (node->erased) {
+      erased.resize(nodes.size(), 0);
+      erased[records.size()] = 1;
+    }
+    records.push_back(frozen);
+  }
+
+  ImageHeader header;
+  std::memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+  header.version = IMAGE_VERSION;
+  header.byte_order = IMAGE_BYTE_ORDER;
+  header.nodes_count = records.size();
+  header.points_count = xs.size();
+  header.edges_count = edges_lefts.size();
+  header.trapezoids_count = trapezoids_indices.size();
+  header.has_erased = !erased.empty();
+  const ImageLayout layout(header);
+  // Words keep sections aligned.
+  auto storage = std::make_shared<std::vector<std::uint64_t>>(
+      layout.size / sizeof(std::uint64_t), 0);
+  char* image = reinterpret_cast<char*>(storage->data());
+  std::memcpy(image, &header, sizeof(header));
+  copy_section(image, layout.nodes, records);
+  copy_section(image, layout.xs, xs);
+  copy_section(image, layout.ys, ys);
+  copy_section(image, layout.edges_lefts, edges_lefts);
+  copy_section(image, layout.edges_rights, edges_rights);
+  copy_section(image, layout.erased, erased);
+  set_image(storage, image, layout.size);
+}
+
+void FrozenMap::set_image(std::shared_ptr<const void> owner,
+                          const char* image, std::size_t size) {
+  ImageHeader header;
+  if (size < sizeof(header))
+    throw std::runtime_error("Image of the frozen map is truncated.");
+  std::memcpy(&header, image, sizeof(header));
+  if (std::memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0)
+    throw std::runtime_error("Data is not an image of the frozen map.");
+  if (header.version != IMAGE_VERSION)
+    throw std::runtime_error("Unsupported version of the frozen map image.");
+  if (header.byte_order != IMAGE_BYTE_ORDER)
+    throw std::runtime_error(
+        "Image of the frozen map has different byte order.");
+  // Counts are bounded first, so offsets do not overflow.
+  if (header.nodes_count > size || header.points_count > size ||
+      header.edges_count > size || ImageLayout(header).size > size)
+    throw std::runtime_error("Image of the frozen map is truncated.");
+  const ImageLayout layout(header);
+  _owner = std::move(owner);
+  _image = image;
+  _image_size = layout.size;
+  _nodes = reinterpret_cast<const Record*>(image + layout.nodes);
+  _nodes_count = header.nodes_count;
+  _xs = reinterpret_cast<const double*>(image + layout.xs);
+  _ys = reinterpret_cast<const double*>(image + layout.ys);
+  _points_count = header.points_count;
+  _edges_lefts = reinterpret_cast<const std::uint32_t*>(
+      image + layout.edges_lefts);
+  _edges_rights = reinterpret_cast<const std::uint32_t*>(
+      image + layout.edges_rights);
+  _edges_count = header.edges_count;
+  _erased = header.has_erased
+                ? reinterpret_cast<const std::uint8_t*>(image + layout.erased)
+                : nullptr;
+  _trapezoids_count = header.trapezoids_count;
+
+  // Indices are checked once, so searches stay within the image.
+  bool valid = _nodes_count > 0;
+  for (std::size_t index = 0; valid && index < _edges_count; ++index)
+    valid = _edges_lefts[index] < _points_count &&
+            _edges_rights[index] < _points_count;
+  for (std::size_t index = 0; valid && index < _nodes_count; ++index) {
+    const Record& node = _nodes[index];
+    switch (node.type) {
+      case Node::Type_XNode:
+      case Node::Type_YNode:
+        valid = node.index < (node.type == Node::Type_XNode ? _points_count
+                                                            : _edges_count) &&
+                node.first < _nodes_count && node.second < _nodes_count;
+        break;
+      case Node::Type_TrapezoidNode:
+        valid = node.index < _trapezoids_count;
+        break;
+      default:
+        valid = false;
+    }
+  }
+  if (!valid)
+    throw std::runtime_error("Image of the frozen map is corrupted.");
+}
+
+void FrozenMap::save(const std::string& path) const {
+  std::ofstream stream(path, std::ios::binary);
+  if (stream) stream.write(_image, _image_size);
+  if (!stream)
+    throw std::runtime_error("Unable to write frozen map to " + path);
+}
+
+FrozenMap FrozenMap::attach(const std::string& path) {
+  const std::string message = "Unable to attach frozen map from " + path;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) throw std::runtime_error(message);
+  LARGE_INTEGER file_size;
+  HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0
+                       ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0,
+                                            0, nullptr)
+                       : nullptr;
+  CloseHandle(file);
+  if (mapping == nullptr) throw std::runtime_error(message);
+  void* memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  // View keeps the mapping open.
+  CloseHandle(mapping);
+  if (memory == nullptr) throw std::runtime_error(message);
+  const std::size_t size = static_cast<std::size_t>(file_size.QuadPart);
+  std::shared_ptr<const void> owner(
+      memory, [](void* memory) { UnmapViewOfFile(memory); });
+#else
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) throw std::runtime_error(message);
+  struct stat status;
+  void* memory = fstat(descriptor, &status) == 0 && status.st_size > 0
+                     ? mmap(nullptr, static_cast<std::size_t>(status.st_size),
+                            PROT_READ, MAP_SHARED, descriptor, 0)
+                     : MAP_FAILED;
+  // Mapping stays valid after the descriptor is closed.
+  close(descriptor);
+  if (memory == MAP_FAILED) throw std::runtime_error(message);
+  const std::size_t size = static_cast<std::size_t>(status.st_size);
+  std::shared_ptr<const void> owner(
+      memory, [size](void* memory) { munmap(memory, size); });
+#endif
+  FrozenMap result;
+  result.set_image(std::move(owner), static_cast<const char*>(memory), size);
+  return result;
+}
+
+static void locate_scalar(const FrozenMap::Record* nodes, const double* xs,
+                          const double* ys, const std::uint32_t* edges_lefts,
+                          const std::uint32_t* edges_rights,
+                          const std::uint8_t* erased,
+                          const double* coordinates, std::size_t count,
+                          std::int64_t* indices, std::uint8_t* kinds) {
+  for (std::size_t index = 0; index < count; ++index) {
+    const double x = coordinates[2 * index], y = coordinates[2 * index + 1];
+    const FrozenMap::Record* node = nodes;
+    for (;;) {
+      if (node->type == Node::Type_XNode) {
+        // Same as Point::is_right_of.
+        const double point_x = xs[node->index], point_y = ys[node->index];
+        if (x == point_x && y == point_y &&
+            !(erased != nullptr && erased[node - nodes])) {
+          kinds[index] = Locator::Kind_Point;
+          break;
+        }
+        node = nodes + ((x == point_x ? y > point_y : x > point_x)
+                            ? node->second
+                            : node->first);
+      } else if (node->type == Node::Type_YNode) {
+        // Same as Edge::get_point_orientation.
+        const std::uint32_t left = edges_lefts[node->index],
+                            right = edges_rights[node->index];
+        const int orient = orientation(Point(x, y), Point(xs[left], ys[left]),
+                                       Point(xs[right], ys[right]));
+        if (orient > 0)
+          node = nodes + node->first;
+        else if (orient < 0)
+          node = nodes + node->second;
+        else if (erased != nullptr && erased[node - nodes])
+          node = nodes + node->first;
+        else {
+          kinds[index] = Locator::Kind_Edge;
+          break;
+        }
+      } else {
+        kinds[index] = Locator::Kind_Trapezoid;
+        break;
+      }
+    }
+    indices[index] = node->index;
+  }
+}
+
+#ifdef FROZEN_MAP_HAS_AVX2
+static bool has_avx2() {
+  static const bool result = __builtin_cpu_supports("avx2");
+  return result;
+}
+
+/* Descends the graph for 4 points in lockstep:
+ * each step loads records of the current nodes of all lanes,
+ * evaluates both XNode and YNode decisions with the same comparisons
+ * as the scalar version and selects the one matching lane's node type.
+ * Lane which has reached its result is refilled with the next point,
+ * so lanes do not wait for each other to finish. */
+__attribute__((target("avx2"))) static void locate_avx2(
+    const FrozenMap::Record* nodes, const double* xs, const double* ys,
+    const std::uint32_t* edges_lefts, const std::uint32_t* edges_rights,
+    const double* coordinates, std::size_t count, std::int64_t* indices,
+    std::uint8_t* kinds) {
+  const int lanes_count = 4;
+  alignas(32) double lanes_xs[lanes_count], lanes_ys[lanes_count];
+  alignas(16) std::uint32_t lanes_nodes[lanes_count] = {0, 0, 0, 0};
+  alignas(16) std::uint32_t lanes_indices[lanes_count];
+  std::size_t lanes_queries[lanes_count];
+  std::size_t next_query = 0;
+  for (int lane = 0; lane < lanes_count; ++lane) {
+    lanes_queries[lane] = next_query++;
+    lanes_xs[lane] = coordinates[2 * lanes_queries[lane]];
+    lanes_ys[lane] = coordinates[2 * lanes_queries[lane] + 1];
+  }
+  const __m128i x_node_type = _mm_set1_epi32(Node::Type_XNode);
+  const __m128i y_node_type = _mm_set1_epi32(Node::Type_YNode);
+  const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+  const __m256d zeros = _mm256_setzero_pd();
+  const __m256d sign_mask = _mm256_set1_pd(-0.);
+  const __m256d error_bound = _mm256_set1_pd(ORIENTATION_ERROR_BOUND);
+  int active = (1 << lanes_count) - 1;
+  while (active) {
+    const __m256d x = _mm256_load_pd(lanes_xs);
+    const __m256d y = _mm256_load_pd(lanes_ys);
+    // Records are loaded whole and transposed instead of using hardware
+    // gathers, which are microcoded and slow on many processors.
+    __m128 first_record = _mm_castsi128_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(nodes + lanes_nodes[0])));
+    __m128 second_record = _mm_castsi128_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(nodes + lanes_nodes[1])));
+    __m128 third_record = _mm_castsi128_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(nodes + lanes_nodes[2])));
+    __m128 fourth_record = _mm_castsi128_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(nodes + lanes_nodes[3])));
+    _MM_TRANSPOSE4_PS(first_record, second_record, third_record,
+                      fourth_record);
+    const __m128i type = _mm_castps_si128(first_record);
+    const __m128i index = _mm_castps_si128(second_record);
+    const __m128i first = _mm_castps_si128(third_record);
+    const __m128i second = _mm_castps_si128(fourth_record);
+    const __m128i is_x_node = _mm_cmpeq_epi32(type, x_node_type);
+    const __m128i is_y_node = _mm_cmpeq_epi32(type, y_node_type);
+    // XNode lanes take their point, YNode lanes take endpoints of their edge,
+    // other lanes take endpoints of edge 0 so that all loads stay in bounds.
+    alignas(16) std::uint32_t edges[lanes_count], starts[lanes_count],
+        ends[lanes_count];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes_indices), index);
+    _mm_store_si128(reinterpret_cast<__m128i*>(edges),
+                    _mm_and_si128(index, is_y_node));
+    for (int lane = 0; lane < lanes_count; ++lane) {
+      starts[lane] = edges_lefts[edges[lane]];
+      ends[lane] = edges_rights[edges[lane]];
+    }
+    _mm_store_si128(reinterpret_cast<__m128i*>(starts),
+                    _mm_blendv_epi8(
+                        _mm_load_si128(reinterpret_cast<__m128i*>(starts)),
+                        index, is_x_node));
+    const __m256d start_x = _mm256_setr_pd(xs[starts[0]], xs[starts[1]],
+                                           xs[starts[2]], xs[starts[3]]);
+    const __m256d start_y = _mm256_setr_pd(ys[starts[0]], ys[starts[1]],
+                                           ys[starts[2]], ys[starts[3]]);
+    const __m256d end_x =
+        _mm256_setr_pd(xs[ends[0]], xs[ends[1]], xs[ends[2]], xs[ends[3]]);
+    const __m256d end_y =
+        _mm256_setr_pd(ys[ends[0]], ys[ends[1]], ys[ends[2]], ys[ends[3]]);
+    // Same as Point::is_right_of.
+    const __m256d same_x = _mm256_cmp_pd(x, start_x, _CMP_EQ_OQ);
+    const __m256d same_point =
+        _mm256_and_pd(same_x, _mm256_cmp_pd(y, start_y, _CMP_EQ_OQ));
+    const __m256d is_right = _mm256_blendv_pd(
+        _mm256_cmp_pd(x, start_x, _CMP_GT_OQ),
+        _mm256_cmp_pd(y, start_y, _CMP_GT_OQ), same_x);
+    // Same as Edge::get_point_orientation.
+    const __m256d left_product =
+        _mm256_mul_pd(_mm256_sub_pd(x, start_x), _mm256_sub_pd(end_y, start_y));
+    const __m256d right_product =
+        _mm256_mul_pd(_mm256_sub_pd(y, start_y), _mm256_sub_pd(end_x, start_x));
+    __m256d cross_z = _mm256_sub_pd(left_product, right_product);
+    // YNode lanes with cross products within the error bound
+    // (including zero ones) are resolved by the scalar predicate.
+    const __m256d bound = _mm256_mul_pd(
+        error_bound, _mm256_add_pd(_mm256_andnot_pd(sign_mask, left_product),
+                                   _mm256_andnot_pd(sign_mask, right_product)));
+    const int uncertain =
+        _mm_movemask_ps(_mm_castsi128_ps(is_y_node)) &
+        _mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign_mask, cross_z),
+                                         bound, _CMP_LE_OQ));
+    if (uncertain) {
+      alignas(32) double lanes_cross_z[lanes_count];
+      _mm256_store_pd(lanes_cross_z, cross_z);
+      for (int lane = 0; lane < lanes_count; ++lane)
+        if (uncertain >> lane & 1)
+          lanes_cross_z[lane] = orientation(
+              Point(lanes_xs[lane], lanes_ys[lane]),
+              Point(xs[starts[lane]], ys[starts[lane]]),
+              Point(xs[ends[lane]], ys[ends[lane]]));
+      cross_z = _mm256_load_pd(lanes_cross_z);
+    }
+    const __m256d is_below = _mm256_cmp_pd(cross_z, zeros, _CMP_GT_OQ);
+    const __m256d is_above = _mm256_cmp_pd(cross_z, zeros, _CMP_LT_OQ);
+    const __m128i to_second = _mm_or_si128(
+        _mm_and_si128(is_x_node,
+                      _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+                          _mm256_castpd_si256(is_right), low_halves))),
+        _mm_and_si128(is_y_node,
+                      _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+                          _mm256_castpd_si256(is_above), low_halves))));
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes_nodes),
+                    _mm_blendv_epi8(first, second, to_second));
+    const int x_nodes = _mm_movemask_ps(_mm_castsi128_ps(is_x_node));
+    const int y_nodes = _mm_movemask_ps(_mm_castsi128_ps(is_y_node));
+    const int points_hits = x_nodes & _mm256_movemask_pd(same_point);
+    const int edges_hits =
+        y_nodes & ~_mm256_movemask_pd(_mm256_or_pd(is_below, is_above));
+    const int finished =
+        active & (points_hits | edges_hits | ~(x_nodes | y_nodes));
+    if (!finished) continue;
+    for (int lane = 0; lane < lanes_count; ++lane) {
+      if (!(finished >> lane & 1)) continue;
+      const std::size_t query = lanes_queries[lane];
+      indices[query] = lanes_indices[lane];
+      kinds[query] = (points_hits >> lane & 1)
+                         ? Locator::Kind_Point
+                         : (edges_hits >> lane & 1) ? Locator::Kind_Edge
+                                                    : Locator::Kind_Trapezoid;
+      lanes_nodes[lane] = 0;
+      if (next_query < count) {
+        lanes_queries[lane] = next_query++;
+        lanes_xs[lane] = coordinates[2 * lanes_queries[lane]];
+        lanes_ys[lane] = coordinates[2 * lanes_queries[lane] + 1];
+      } else
+        active &= ~(1 << lane);
+    }
+  }
+}
+#endif
+
+bool FrozenMap::has_lockstep_kernel() {
+#ifdef FROZEN_MAP_HAS_AVX2
+  return has_avx2();
+#else
+  return false;
+#endif
+}
+
+void FrozenMap::locate(const double* coordinates, std::size_t count,
+                       std::int64_t* indices, std::uint8_t* kinds,
+                       bool lockstep) const {
+#ifdef FROZEN_MAP_HAS_AVX2
+  if (lockstep && count >= 4 && _edges_count > 0 && _erased == nullptr &&
+      has_avx2()) {
+    locate_avx2(_nodes, _xs, _ys, _edges_lefts, _edges_rights, coordinates,
+                count, indices, kinds);
+    return;
+  }
+#else
+  (void)lockstep;
+#endif
+  locate_scalar(_nodes, _xs, _ys, _edges_lefts, _edges_rights, _erased,
+                coordinates, count, indices, kinds);
+}
@@ -0,0 +1,94 @@
+#ifndef FROZEN_MAP_H
+#define FROZEN_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "locator.h"
+#include "node.h"
+
+/* Read-only search structure compiled from the search graph rooted
+ * at the specified Node.
+ * Nodes are stored contiguously in Node::collect_nodes order (so root is
+ * the first one) as compact records referring to each other,
+ * to points, edges and trapezoids by 32-bit indices,
+ * and coordinates are stored in separate arrays.
+ * Points, edges and trapezoids are numbered exactly like in Locator,
+ * endpoints of edges which are not points of any XNode are appended
+ * after the Locator ones.
+ * Frozen map does not refer to the search graph after construction.
+ *
+ * All of the arrays are laid out in a single pointer-free image
+ * (a header followed by the sections of arrays aligned to 8 bytes)
+ * in the native byte order, which can be saved to a file
+ * and attached by other processes: the file is memory-mapped read-only
+ * and queried in place, so processes attached to the same file
+ * (e.g. in /dev/shm for POSIX shared memory) share its single physical copy.
+ * Copies of a frozen map share its image. */
+class FrozenMap {
+ public:
+  struct Record {
+    std::uint32_t type;    // Node::Type of the original Node.
+    std::uint32_t index;   // Index of the point, edge or trapezoid.
+    std::uint32_t first;   // Index of the left/below child node.
+    std::uint32_t second;  // Index of the right/above child node.
+  };
+
+  explicit FrozenMap(const Node& root);
+
+  /* Locate count points specified by interleaved x & y coordinates,
+   * writing index and Locator::Kind of the search result for each of them
+   * into the corresponding output arrays.
+   * With lockstep set points are descended 4 at a time using AVX2
+   * if the processor supports it (see has_lockstep_kernel)
+   * and the graph has no nodes of erased points & edges,
+   * results are the same either way. */
+  void locate(const double* coordinates, std::size_t count,
+              std::int64_t* indices, std::uint8_t* kinds,
+              bool lockstep = false) const;
+
+  static bool has_lockstep_kernel();
+
+  // Write the image to the file.
+  void save(const std::string& path) const;
+
+  /* Map the image written by save to the memory read-only,
+   * it stays mapped while any of copies of the result exists.
+   * Image should be written on a platform with the same byte order. */
+  static FrozenMap attach(const std::string& path);
+
+  std::size_t edges_count() const { return _edges_count; }
+  std::size_t nodes_count() const { return _nodes_count; }
+  std::size_t points_count() const { return _points_count; }
+  std::size_t trapezoids_count() const { return _trapezoids_count; }
+
+ private:
+  FrozenMap() = default;
+
+  /* Validate the image of the specified size and point arrays into it,
+   * the image is kept alive by the owner. */
+  void set_image(std::shared_ptr<const void> owner, const char* image,
+                 std::size_t size);
+
+  std::shared_ptr<const void> _owner;
+  const char* _image = nullptr;
+  std::size_t _image_size = 0;
+  const Record* _nodes = nullptr;
+  std::size_t _nodes_count = 0;
+  // Coordinates of points.
+  const double* _xs = nullptr;
+  const double* _ys = nullptr;
+  std::size_t _points_count = 0;
+  // Indices of edges endpoints.
+  const std::uint32_t* _edges_lefts = nullptr;
+  const std::uint32_t* _edges_rights = nullptr;
+  std::size_t _edges_count = 0;
+  // Flags of nodes of erased points & edges, null if there are none.
+  const std::uint8_t* _erased = nullptr;
+  std::size_t _trapezoids_count = 0;
+};
+
+#endif
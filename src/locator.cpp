@@ -0,0 +1,123 @@
+#include "locator.h"
+
+Locator::Locator(const Node& root) { _root_record = add_records(root); }
+
+std::size_t Locator::add_records(const Node& root) {
+  // Same pre-order as Node::collect_nodes, stopping at recorded nodes.
+  std::vector<const Node*> added;
+  std::vector<const Node*> stack{&root};
+  while (!stack.empty()) {
+    const Node* node = stack.back();
+    stack.pop_back();
+    auto position = _nodes_records.emplace(node, _records.size());
+    if (!position.second) continue;
+    if (_free_records.empty())
+      _records.push_back(Record{node, 0, 0, 0});
+    else {
+      position.first->second = _free_records.back();
+      _free_records.pop_back();
+      _records[position.first->second] = Record{node, 0, 0, 0};
+    }
+    added.push_back(node);
+    switch (node->type) {
+      case Node::Type_XNode:
+        stack.push_back(node->data.xnode.right);
+        stack.push_back(node->data.xnode.left);
+        break;
+      case Node::Type_YNode:
+        stack.push_back(node->data.ynode.above);
+        stack.push_back(node->data.ynode.below);
+        break;
+      case Node::Type_TrapezoidNode:
+        break;
+    }
+  }
+  for (const Node* node : added) set_record(*node);
+  return _nodes_records.at(&root);
+}
+
+void Locator::set_record(const Node& node) {
+  Record& record = _records[_nodes_records.at(&node)];
+  switch (node.type) {
+    case Node::Type_XNode: {
+      const Point* point = node.data.xnode.point;
+      auto position = _points_indices.emplace(point, _points.size());
+      if (position.second) _points.push_back(point);
+      record.index = position.first->second;
+      record.first = _nodes_records.at(node.data.xnode.left);
+      record.second = _nodes_records.at(node.data.xnode.right);
+      break;
+    }
+    case Node::Type_YNode: {
+      const Edge* edge = node.data.ynode.edge;
+      auto position = _edges_indices.emplace(edge, _edges.size());
+      if (position.second) _edges.push_back(edge);
+      record.index = position.first->second;
+      record.first = _nodes_records.at(node.data.ynode.below);
+      record.second = _nodes_records.at(node.data.ynode.above);
+      break;
+    }
+    case Node::Type_TrapezoidNode:
+      record.index = _trapezoids.size();
+      _trapezoids.push_back(node.data.trapezoid);
+      break;
+  }
+}
+
+void Locator::replace(const Node& node, const Node& replacement) {
+  std::size_t record = add_records(replacement);
+  // Former parents of the node are among the ones of the replacement.
+  for (const Node* parent : replacement.get_parents()) {
+    Record& parent_record = _records[_nodes_records.at(parent)];
+    bool split = parent->type == Node::Type_XNode;
+    parent_record.first = _nodes_records.at(
+        split ? parent->data.xnode.left : parent->data.ynode.below);
+    parent_record.second = _nodes_records.at(
+        split ? parent->data.xnode.right : parent->data.ynode.above);
+  }
+  auto position = _nodes_records.find(&node);
+  if (position->second == _root_record) _root_record = record;
+  if (node.type == Node::Type_TrapezoidNode) {
+    // Last trapezoid takes the index of the dropped one.
+    std::int64_t index = _records[position->second].index;
+    const Trapezoid* last = _trapezoids.back();
+    _records[_nodes_records.at(last->trapezoid_node)].index = index;
+    _trapezoids[index] = last;
+    _trapezoids.pop_back();
+  }
+  _free_records.push_back(position->second);
+  _nodes_records.erase(position);
+}
+
+void Locator::locate(const double* coordinates, std::size_t count,
+                     std::int64_t* indices, std::uint8_t* kinds) const {
+  for (std::size_t index = 0; index < count; ++index) {
+    const Point xy(coordinates[2 * index], coordinates[2 * index + 1]);
+    // Same as Node::search.
+    const Record* record = _records.data() + _root_record;
+    for (;;) {
+      const Node* node = record->node;
+      if (node->type == Node::Type_XNode) {
+        const Point& point = *node->data.xnode.point;
+        if (xy == point && !node->erased) {
+          kinds[index] = Kind_Point;
+          break;
+        }
+        record = _records.data() +
+                 (xy.is_right_of(point) ? record->second : record->first);
+      } else if (node->type == Node::Type_YNode) {
+        int orient = node->data.ynode.edge->get_point_orientation(xy);
+        if (orient == 0 && !node->erased) {
+          kinds[index] = Kind_Edge;
+          break;
+        }
+        record = _records.data() + (orient < 0 ? record->second
+                                               : record->first);
+      } else {
+        kinds[index] = Kind_Trapezoid;
+        break;
+      }
+    }
+    indices[index] = record->index;
+  }
+}
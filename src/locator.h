@@ -0,0 +1,82 @@
+#ifndef LOCATOR_H
+#define LOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "edge.h"
+#include "node.h"
+#include "point.h"
+#include "trapezoid.h"
+
+/* Batch point location in the search graph rooted at the specified Node.
+ * Trapezoids, points and edges of the search graph are numbered
+ * in order of their first occurrence in Node::collect_nodes,
+ * so the result of each search can be reported as a pair of plain integers:
+ * the index of the found item and the kind of it.
+ * Nodes are numbered in Node::collect_nodes order as records holding
+ * indices of their items and children, so searches descend the records
+ * with the same decisions as Node::search and read the index
+ * of the found item from its record.
+ * Search graph is not owned and should outlive the Locator,
+ * which should be either recreated or updated by replace
+ * after the graph is changed: items of new nodes are numbered
+ * after the existing ones and the last trapezoid takes the index
+ * of a removed one. */
+class Locator {
+ public:
+  // Kinds of search results: Point is located inside of a Trapezoid,
+  // on a Point of an XNode or on an Edge of a YNode.
+  typedef enum { Kind_Trapezoid, Kind_Point, Kind_Edge } Kind;
+
+  explicit Locator(const Node& root);
+
+  /* Locate count points specified by interleaved x & y coordinates,
+   * writing index and kind of the search result for each of them
+   * into the corresponding output arrays. */
+  void locate(const double* coordinates, std::size_t count,
+              std::int64_t* indices, std::uint8_t* kinds) const;
+
+  /* Update records after the node is replaced by the specified one
+   * in all of its parents (or as the root), adding records of the nodes
+   * reachable from the replacement which are new to the Locator
+   * and dropping the record of the node, which should not be
+   * destroyed before the call. */
+  void replace(const Node& node, const Node& replacement);
+
+  const std::vector<const Edge*>& edges() const { return _edges; }
+  const std::vector<const Point*>& points() const { return _points; }
+  const std::vector<const Trapezoid*>& trapezoids() const {
+    return _trapezoids;
+  }
+
+ private:
+  struct Record {
+    const Node* node;
+    std::int64_t index;  // Index of the point, edge or trapezoid.
+    std::size_t first;   // Index of the left/below child record.
+    std::size_t second;  // Index of the right/above child record.
+  };
+
+  /* Add records of the nodes reachable from the specified one
+   * which have none, returning index of its record. */
+  std::size_t add_records(const Node& root);
+
+  // Set indices of the item and the children records of the node.
+  void set_record(const Node& node);
+
+  // Records of nodes, slots of the dropped ones are reused.
+  std::vector<Record> _records;
+  std::vector<std::size_t> _free_records;
+  std::size_t _root_record = 0;
+  std::unordered_map<const Node*, std::size_t> _nodes_records;
+  std::unordered_map<const Edge*, std::int64_t> _edges_indices;
+  std::unordered_map<const Point*, std::int64_t> _points_indices;
+  std::vector<const Edge*> _edges;
+  std::vector<const Point*> _points;
+  std::vector<const Trapezoid*> _trapezoids;
+};
+
+#endif
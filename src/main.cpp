@@ -1,16 +1,31 @@
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iomanip>
 #include <limits>
+#include <memory>
+#include <shared_mutex>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "bounding_box.h"
+#include "byte_buffer.h"
 #include "edge.h"
+#include "frozen_map.h"
+#include "locator.h"
 #include "node.h"
 #include "point.h"
+#include "search_profile.h"
+#include "thread_pool.h"
 #include "trapezoid.h"
 #include "trapezoidal_map.h"
 
@@ -21,11 +36,22 @@ namespace py = pybind11;
 #define C_STR(a) C_STR_HELPER(a)
 #define BOUNDING_BOX_NAME "BoundingBox"
 #define EDGE_NAME "Edge"
+#define FROZEN_MAP_NAME "FrozenMap"
 #define LEAF_NAME "Leaf"
+#define LEAF_VIEW_NAME "LeafView"
+#define LOCATOR_NAME "Locator"
 #define POINT_NAME "Point"
+#define SEARCH_PROFILE_NAME "SearchProfile"
+#define THREAD_POOL_NAME "ThreadPool"
+#define NODE_VIEW_NAME "NodeView"
 #define TRAPEZOID_NAME "Trapezoid"
+#define TRAPEZOID_VIEW_NAME "TrapezoidView"
+#define TRAPEZOIDAL_MAP_NAME "TrapezoidalMap"
+#define TRAPEZOIDAL_MAP_STATS_NAME "TrapezoidalMapStats"
 #define X_NODE_NAME "XNode"
+#define X_NODE_VIEW_NAME "XNodeView"
 #define Y_NODE_NAME "YNode"
+#define Y_NODE_VIEW_NAME "YNodeView"
 
 static std::string bool_repr(bool value) { return py::str(py::bool_(value)); }
 
@@ -233,7 +259,10 @@ class NodeProxy : public Node {
   NodeProxy(const TrapezoidProxy& trapezoid_)
       : Node(new TrapezoidProxy(trapezoid_)) {}
 
-  virtual ~NodeProxy(){};
+  virtual ~NodeProxy() {
+    // Unlike native Nodes proxy leaves own their Trapezoids.
+    if (type == Type_TrapezoidNode) delete data.trapezoid;
+  }
 };
 
 static NodeProxy* node_to_proxy(const Node& node);
@@ -290,24 +319,608 @@ NodeProxy* YNode::below() const { return cast_node_to_proxy(data.ynode.below); }
 
 NodeProxy* YNode::above() const { return cast_node_to_proxy(data.ynode.above); }
 
-static NodeProxy* node_to_proxy(const Node& node) {
+/* Search graph is a DAG, so proxies are memoized to create a single proxy
+ * for each Node no matter how many parents it has.
+ * Children are converted before their parents with an explicit stack. */
+static NodeProxy* node_to_proxy(const Node& root) {
+  std::unordered_map<const Node*, NodeProxy*> proxies;
+  std::vector<const Node*> stack{&root};
+  while (!stack.empty()) {
+    const Node* node = stack.back();
+    if (proxies.find(node) != proxies.end()) {
+      stack.pop_back();
+      continue;
+    }
+    NodeProxy* proxy = nullptr;
+    switch (node->type) {
+      case Node::Type_XNode: {
+        auto left = proxies.find(node->data.xnode.left);
+        auto right = proxies.find(node->data.xnode.right);
+        if (left != proxies.end() && right != proxies.end())
+          proxy = new XNode(*node->data.xnode.point, left->second,
+                            right->second);
+        else {
+          if (right == proxies.end()) stack.push_back(node->data.xnode.right);
+          if (left == proxies.end()) stack.push_back(node->data.xnode.left);
+        }
+        break;
+      }
+      case Node::Type_YNode: {
+        auto below = proxies.find(node->data.ynode.below);
+        auto above = proxies.find(node->data.ynode.above);
+        if (below != proxies.end() && above != proxies.end())
+          proxy = new YNode(*node->data.ynode.edge, below->second,
+                            above->second);
+        else {
+          if (above == proxies.end()) stack.push_back(node->data.ynode.above);
+          if (below == proxies.end()) stack.push_back(node->data.ynode.below);
+        }
+        break;
+      }
+      case Node::Type_TrapezoidNode:
+        proxy = new Leaf(*node->data.trapezoid);
+        break;
+    }
+    if (proxy != nullptr) {
+      proxy->erased = node->erased;
+      proxies.emplace(node, proxy);
+      stack.pop_back();
+    }
+  }
+  // Restore the original order of parents, the ones outside of the converted
+  // subgraph are skipped.
+  for (const auto& entry : proxies)
+    for (Node* parent : entry.first->get_parents()) {
+      auto position = proxies.find(parent);
+      if (position == proxies.end()) continue;
+      // Moves the parent to the end of the list.
+      entry.second->remove_parent(position->second);
+      entry.second->add_parent(position->second);
+    }
+  return proxies[&root];
+}
+
+NodeProxy* TrapezoidProxy::get_trapezoid_node() const {
+  if (trapezoid_node == nullptr) return nullptr;
+  return node_to_proxy(*trapezoid_node);
+}
+
+/* Graphs of proxies are pickled as a single buffer in the little-endian
+ * format starting with the magic, the version and counts of records
+ * of the following sections: points & edges deduplicated by value,
+ * trapezoids of leaves with indices of their neighbours among them,
+ * nodes in post-order (so children precede their parents and the root
+ * is the last one) and parents of each node in their order.
+ * Neighbours & parents outside of the graph are not kept. */
+static const char GRAPH_MAGIC[8] = {'S', 'E', 'I', 'D', 'E', 'L', 'N', 'G'};
+static const std::uint32_t GRAPH_FORMAT_VERSION = 1;
+// Index of the absent neighbour trapezoid.
+static const std::uint32_t GRAPH_NO_INDEX = 0xFFFFFFFF;
+
+struct PointBitsHash {
+  std::size_t operator()(
+      const std::pair<std::uint64_t, std::uint64_t>& bits) const {
+    return std::hash<std::uint64_t>()(bits.first * 31 + bits.second);
+  }
+};
+
+static std::vector<char> graph_to_bytes(const Node& root) {
+  const std::vector<const Node*> nodes = root.collect_nodes_bottom_up();
+  if (nodes.size() >= GRAPH_NO_INDEX)
+    throw std::length_error("Graph is too large to be pickled.");
+  std::unordered_map<const Node*, std::uint32_t> nodes_indices;
+  std::unordered_map<const Trapezoid*, std::uint32_t> trapezoids_indices;
+  for (const Node* node : nodes) {
+    nodes_indices.emplace(node, nodes_indices.size());
+    if (node->type == Node::Type_TrapezoidNode)
+      trapezoids_indices.emplace(node->data.trapezoid,
+                                 trapezoids_indices.size());
+  }
+  // Points are identified by bits of coordinates,
+  // so 0. and -0. stay distinct.
+  std::vector<Point> points;
+  std::unordered_map<std::pair<std::uint64_t, std::uint64_t>, std::uint32_t,
+                     PointBitsHash>
+      points_indices;
+  auto point_index = [&](const Point& point) {
+    std::pair<std::uint64_t, std::uint64_t> bits;
+    std::memcpy(&bits.first, &point.x, sizeof(bits.first));
+    std::memcpy(&bits.second, &point.y, sizeof(bits.second));
+    auto position = points_indices.emplace(bits, points.size());
+    if (position.second) points.push_back(point);
+    return position.first->second;
+  };
+  // Edges are packed pairs of endpoints indices.
+  std::vector<std::uint64_t> edges;
+  std::unordered_map<std::uint64_t, std::uint32_t> edges_indices;
+  auto edge_index = [&](const Edge& edge) {
+    std::uint64_t endpoints =
+        static_cast<std::uint64_t>(point_index(*edge.left)) << 32 |
+        point_index(*edge.right);
+    auto position = edges_indices.emplace(endpoints, edges.size());
+    if (position.second) edges.push_back(endpoints);
+    return position.first->second;
+  };
+  auto trapezoid_index = [&](const Trapezoid* trapezoid) {
+    auto position = trapezoids_indices.find(trapezoid);
+    return position == trapezoids_indices.end() ? GRAPH_NO_INDEX
+                                                : position->second;
+  };
+
+  // Records are collected before writing, so that points & edges
+  // are indexed.
+  std::vector<std::uint32_t> trapezoids_records, nodes_records;
+  for (const Node* node : nodes) {
+    switch (node->type) {
+      case Node::Type_XNode:
+        nodes_records.insert(nodes_records.end(),
+                             {point_index(*node->data.xnode.point),
+                              nodes_indices.at(node->data.xnode.left),
+                              nodes_indices.at(node->data.xnode.right)});
+        break;
+      case Node::Type_YNode:
+        nodes_records.insert(nodes_records.end(),
+                             {edge_index(*node->data.ynode.edge),
+                              nodes_indices.at(node->data.ynode.below),
+                              nodes_indices.at(node->data.ynode.above)});
+        break;
+      case Node::Type_TrapezoidNode: {
+        const Trapezoid& trapezoid = *node->data.trapezoid;
+        nodes_records.insert(nodes_records.end(),
+                             {trapezoid_index(&trapezoid), 0, 0});
+        trapezoids_records.insert(
+            trapezoids_records.end(),
+            {point_index(*trapezoid.left), point_index(*trapezoid.right),
+             edge_index(trapezoid.below), edge_index(trapezoid.above),
+             trapezoid_index(trapezoid.lower_left),
+             trapezoid_index(trapezoid.lower_right),
+             trapezoid_index(trapezoid.upper_left),
+             trapezoid_index(trapezoid.upper_right)});
+        break;
+      }
+    }
+  }
+
+  ByteWriter writer;
+  for (char byte : GRAPH_MAGIC)
+    writer.write(static_cast<unsigned char>(byte), 1);
+  writer.write(GRAPH_FORMAT_VERSION, 4);
+  for (std::size_t count :
+       {points.size(), edges.size(), trapezoids_indices.size(), nodes.size()})
+    writer.write(count, 8);
+  for (const Point& point : points) {
+    writer.write_double(point.x);
+    writer.write_double(point.y);
+  }
+  for (std::uint64_t endpoints : edges) writer.write(endpoints >> 32, 4);
+  for (std::uint64_t endpoints : edges) writer.write(endpoints, 4);
+  for (std::uint32_t value : trapezoids_records) writer.write(value, 4);
+  for (std::size_t index = 0; index < nodes.size(); ++index) {
+    writer.write(nodes[index]->type, 1);
+    writer.write(nodes[index]->erased, 1);
+    for (std::size_t field = 0; field < 3; ++field)
+      writer.write(nodes_records[3 * index + field], 4);
+  }
+  for (const Node* node : nodes) {
+    std::vector<std::uint32_t> parents;
+    for (const Node* parent : node->get_parents()) {
+      auto position = nodes_indices.find(parent);
+      if (position != nodes_indices.end()) parents.push_back(position->second);
+    }
+    writer.write(parents.size(), 4);
+    for (std::uint32_t parent : parents) writer.write(parent, 4);
+  }
+  return std::move(writer.bytes());
+}
+
+/* Read-only array of the bytes owning them via the capsule,
+ * so they are exposed through the buffer protocol without copying
+ * and pickled in-band as bytes. */
+static py::array_t<std::uint8_t> to_bytes_array(std::vector<char>&& bytes) {
+  std::unique_ptr<std::vector<char>> owned(
+      new std::vector<char>(std::move(bytes)));
+  py::capsule owner(owned.get(), [](void* pointer) {
+    delete static_cast<std::vector<char>*>(pointer);
+  });
+  const std::vector<char>& data = *owned.release();
+  py::array_t<std::uint8_t> result(
+      static_cast<py::ssize_t>(data.size()),
+      reinterpret_cast<const std::uint8_t*>(data.data()), owner);
+  result.attr("setflags")(py::arg("write") = false);
+  return result;
+}
+
+static NodeProxy* graph_from_bytes(const char* data, std::size_t size) {
+  ByteReader reader(data, size);
+  for (char byte : GRAPH_MAGIC)
+    if (reader.read(1) != static_cast<unsigned char>(byte))
+      throw std::runtime_error("Data is not a pickled graph.");
+  if (reader.read(4) != GRAPH_FORMAT_VERSION)
+    throw std::runtime_error("Unsupported version of the graph format.");
+  const std::size_t points_count = reader.read_count(16);
+  const std::size_t edges_count = reader.read_count(8);
+  const std::size_t trapezoids_count = reader.read_count(32);
+  const std::size_t nodes_count = reader.read_count(14);
+  if (nodes_count == 0) throw std::runtime_error("Data is corrupted.");
+  std::vector<Point> points;
+  points.reserve(points_count);
+  for (std::size_t index = 0; index < points_count; ++index) {
+    double x = reader.read_double();
+    points.emplace_back(x, reader.read_double());
+  }
+  std::vector<std::uint32_t> edges_endpoints;
+  edges_endpoints.reserve(2 * edges_count);
+  for (std::size_t index = 0; index < 2 * edges_count; ++index)
+    edges_endpoints.push_back(reader.read_index(points_count));
+  std::vector<EdgeProxy> edges;
+  edges.reserve(edges_count);
+  for (std::size_t index = 0; index < edges_count; ++index) {
+    const Point& left = points[edges_endpoints[index]];
+    const Point& right = points[edges_endpoints[edges_count + index]];
+    if (!right.is_right_of(left))
+      throw std::runtime_error("Data is corrupted.");
+    edges.emplace_back(left, right);
+  }
+  std::vector<std::uint32_t> trapezoids_records;
+  trapezoids_records.reserve(8 * trapezoids_count);
+  for (std::size_t index = 0; index < trapezoids_count; ++index) {
+    for (std::size_t field = 0; field < 2; ++field)
+      trapezoids_records.push_back(reader.read_index(points_count));
+    for (std::size_t field = 0; field < 2; ++field)
+      trapezoids_records.push_back(reader.read_index(edges_count));
+    for (std::size_t field = 0; field < 4; ++field) {
+      std::uint64_t neighbour = reader.read(4);
+      if (neighbour != GRAPH_NO_INDEX && neighbour >= trapezoids_count)
+        throw std::runtime_error("Data is corrupted.");
+      trapezoids_records.push_back(static_cast<std::uint32_t>(neighbour));
+    }
+  }
+
+  // Proxies are destroyed if the data turns out to be invalid.
+  std::vector<NodeProxy*> nodes;
+  std::vector<Trapezoid*> trapezoids(trapezoids_count, nullptr);
+  try {
+    nodes.reserve(nodes_count);
+    for (std::size_t index = 0; index < nodes_count; ++index) {
+      std::uint64_t type = reader.read(1);
+      bool erased = reader.read(1) != 0;
+      NodeProxy* node;
+      if (type == Node::Type_TrapezoidNode) {
+        std::uint32_t trapezoid = reader.read_index(trapezoids_count);
+        const std::uint32_t* record = &trapezoids_records[8 * trapezoid];
+        if (trapezoids[trapezoid] != nullptr || reader.read(8) != 0 ||
+            !points[record[1]].is_right_of(points[record[0]]))
+          throw std::runtime_error("Data is corrupted.");
+        node = new Leaf(TrapezoidProxy(points[record[0]], points[record[1]],
+                                       edges[record[2]], edges[record[3]]));
+        trapezoids[trapezoid] = node->data.trapezoid;
+      } else {
+        std::size_t value = reader.read(4);
+        NodeProxy* first = nodes[reader.read_index(nodes.size())];
+        NodeProxy* second = nodes[reader.read_index(nodes.size())];
+        if (first == second) throw std::runtime_error("Data is corrupted.");
+        if (type == Node::Type_XNode && value < points_count)
+          node = new XNode(points[value], first, second);
+        else if (type == Node::Type_YNode && value < edges_count)
+          node = new YNode(edges[value], first, second);
+        else
+          throw std::runtime_error("Data is corrupted.");
+      }
+      node->erased = erased;
+      nodes.push_back(node);
+    }
+    // Moving each parent to the end of the list restores their order.
+    for (NodeProxy* node : nodes) {
+      std::size_t parents_count = reader.read_index(nodes_count + 1);
+      for (std::size_t index = 0; index < parents_count; ++index) {
+        NodeProxy* parent = nodes[reader.read_index(nodes_count)];
+        if (!node->has_parent(parent))
+          throw std::runtime_error("Data is corrupted.");
+        node->remove_parent(parent);
+        node->add_parent(parent);
+      }
+    }
+    if (!reader.at_end()) throw std::runtime_error("Data is corrupted.");
+    for (Trapezoid* trapezoid : trapezoids)
+      if (trapezoid == nullptr) throw std::runtime_error("Data is corrupted.");
+  } catch (...) {
+    while (!nodes.empty()) {
+      delete nodes.back();
+      nodes.pop_back();
+    }
+    throw;
+  }
+  auto get_neighbour = [&](std::uint32_t index) {
+    return index == GRAPH_NO_INDEX ? nullptr : trapezoids[index];
+  };
+  for (std::size_t index = 0; index < trapezoids_count; ++index) {
+    const std::uint32_t* record = &trapezoids_records[8 * index];
+    trapezoids[index]->lower_left = get_neighbour(record[4]);
+    trapezoids[index]->lower_right = get_neighbour(record[5]);
+    trapezoids[index]->upper_left = get_neighbour(record[6]);
+    trapezoids[index]->upper_right = get_neighbour(record[7]);
+  }
+  return nodes.back();
+}
+
+/* Views refer to the parts of a native TrapezoidalMap without copying them
+ * and share ownership of the map, so it is kept alive while they are used.
+ * Corresponding proxies can be materialized on demand with to_proxy. */
+typedef std::shared_ptr<const TrapezoidalMap> MapOwner;
+
+static py::object to_node_view(const MapOwner& map, const Node& node);
+
+static void check_version(const TrapezoidalMap& map, std::size_t version) {
+  if (map.version() != version)
+    throw std::runtime_error("View is invalidated by update of the map.");
+}
+
+class TrapezoidView {
+ public:
+  TrapezoidView(MapOwner map, const Trapezoid& trapezoid)
+      : _map(std::move(map)),
+        _trapezoid(&trapezoid),
+        _version(_map->version()) {}
+
+  bool operator==(const TrapezoidView& other) const {
+    return _trapezoid == other._trapezoid;
+  }
+
+  Point left() const { return *trapezoid().left; }
+
+  Point right() const { return *trapezoid().right; }
+
+  EdgeProxy below() const { return trapezoid().below; }
+
+  EdgeProxy above() const { return trapezoid().above; }
+
+  std::int64_t ring() const { return _map->get_ring(trapezoid()); }
+
+  std::int64_t face() const { return _map->get_face(trapezoid()); }
+
+  py::object lower_left() const { return neighbour(trapezoid().lower_left); }
+
+  py::object lower_right() const {
+    return neighbour(trapezoid().lower_right);
+  }
+
+  py::object upper_left() const { return neighbour(trapezoid().upper_left); }
+
+  py::object upper_right() const {
+    return neighbour(trapezoid().upper_right);
+  }
+
+  py::object trapezoid_node() const {
+    return to_node_view(_map, *trapezoid().trapezoid_node);
+  }
+
+  TrapezoidProxy to_proxy() const {
+    TrapezoidProxy result(trapezoid());
+    // Should not refer to the Node owned by the native map.
+    result.trapezoid_node = nullptr;
+    return result;
+  }
+
+ private:
+  py::object neighbour(const Trapezoid* trapezoid) const {
+    if (trapezoid == nullptr) return py::none();
+    return py::cast(TrapezoidView(_map, *trapezoid));
+  }
+
+  // Trapezoids can be destroyed by updates of the map.
+  const Trapezoid& trapezoid() const {
+    check_version(*_map, _version);
+    return *_trapezoid;
+  }
+
+  MapOwner _map;
+  const Trapezoid* _trapezoid;
+  std::size_t _version;
+};
+
+class NodeView {
+ public:
+  NodeView(MapOwner map, const Node& node)
+      : _map(std::move(map)), _node(&node), _version(_map->version()) {}
+
+  bool operator==(const NodeView& other) const { return _node == other._node; }
+
+  py::list parents() const {
+    py::list result;
+    for (const Node* parent : node().get_parents())
+      result.append(to_node_view(_map, *parent));
+    return result;
+  }
+
+  py::object search_point(const Point& point) const {
+    return to_node_view(_map, *node().search(point));
+  }
+
+  NodeProxy* to_proxy() const { return node_to_proxy(node()); }
+
+ protected:
+  // Nodes can be destroyed by updates of the map.
+  const Node& node() const {
+    check_version(*_map, _version);
+    return *_node;
+  }
+
+  MapOwner _map;
+  const Node* _node;
+  std::size_t _version;
+};
+
+class XNodeView : public NodeView {
+ public:
+  using NodeView::NodeView;
+
+  Point point() const { return *node().data.xnode.point; }
+
+  py::object left() const {
+    return to_node_view(_map, *node().data.xnode.left);
+  }
+
+  py::object right() const {
+    return to_node_view(_map, *node().data.xnode.right);
+  }
+};
+
+class YNodeView : public NodeView {
+ public:
+  using NodeView::NodeView;
+
+  EdgeProxy edge() const { return *node().data.ynode.edge; }
+
+  py::object below() const {
+    return to_node_view(_map, *node().data.ynode.below);
+  }
+
+  py::object above() const {
+    return to_node_view(_map, *node().data.ynode.above);
+  }
+};
+
+class LeafView : public NodeView {
+ public:
+  using NodeView::NodeView;
+
+  TrapezoidView trapezoid() const {
+    return TrapezoidView(_map, *node().data.trapezoid);
+  }
+};
+
+static py::object to_node_view(const MapOwner& map, const Node& node) {
   switch (node.type) {
     case Node::Type_XNode:
-      return new XNode(*node.data.xnode.point,
-                       node_to_proxy(*node.data.xnode.left),
-                       node_to_proxy(*node.data.xnode.right));
+      return py::cast(XNodeView(map, node));
     case Node::Type_YNode:
-      return new YNode(*node.data.ynode.edge,
-                       node_to_proxy(*node.data.ynode.below),
-                       node_to_proxy(*node.data.ynode.above));
+      return py::cast(YNodeView(map, node));
     case Node::Type_TrapezoidNode:
-      return new Leaf(*node.data.trapezoid);
+      return py::cast(LeafView(map, node));
   }
 }
 
-NodeProxy* TrapezoidProxy::get_trapezoid_node() const {
-  if (trapezoid_node == nullptr) return nullptr;
-  return node_to_proxy(*trapezoid_node);
+typedef py::array_t<double, py::array::c_style | py::array::forcecast>
+    CoordinatesArray;
+
+static const std::size_t DEFAULT_CHUNK_SIZE = 1024;
+
+// Adapts Locator of the TrapezoidalMap to be used with locate_points.
+struct MapLocator {
+  const TrapezoidalMap& map;
+  const Locator& locator;
+
+  void locate(const double* coordinates, std::size_t count,
+              std::int64_t* indices, std::uint8_t* kinds) const {
+    locator.locate(coordinates, count, indices, kinds);
+  }
+};
+
+// Adapts TrapezoidalMap::locate_rings to be used with locate_points.
+struct RingsLocator {
+  const TrapezoidalMap& map;
+
+  void locate(const double* coordinates, std::size_t count,
+              std::int64_t* rings, std::uint8_t* kinds) const {
+    map.locate_rings(coordinates, count, rings, kinds);
+  }
+};
+
+// Adapts TrapezoidalMap::locate_faces to be used with locate_points.
+struct FacesLocator {
+  const TrapezoidalMap& map;
+
+  void locate(const double* coordinates, std::size_t count,
+              std::int64_t* values, std::uint8_t* kinds) const {
+    map.locate_faces(coordinates, count, values, kinds);
+  }
+};
+
+static TrapezoidalMap::Order to_order(int order) {
+  if (order < TrapezoidalMap::Order_Input ||
+      order > TrapezoidalMap::Order_Brio)
+    throw std::invalid_argument("Unknown order of insertion of edges.");
+  return static_cast<TrapezoidalMap::Order>(order);
+}
+
+static void flatten_rings(const std::vector<std::vector<Point>>& rings,
+                          std::vector<Point>& points,
+                          std::vector<std::size_t>& rings_offsets) {
+  for (const auto& ring : rings) {
+    rings_offsets.push_back(points.size());
+    points.insert(points.end(), ring.begin(), ring.end());
+  }
+}
+
+typedef std::shared_lock<TrapezoidalMap::Mutex> SharedLock;
+
+/* Searches of a TrapezoidalMap hold its mutex shared while the GIL
+ * is released, so edits of the map from other threads wait for them,
+ * other indices are immutable and are searched without locking. */
+template <class Index>
+static SharedLock lock_shared(const Index&) {
+  return SharedLock();
+}
+
+static SharedLock lock_shared(const MapLocator& index) {
+  return SharedLock(index.map.mutex());
+}
+
+static SharedLock lock_shared(const RingsLocator& index) {
+  return SharedLock(index.map.mutex());
+}
+
+static SharedLock lock_shared(const FacesLocator& index) {
+  return SharedLock(index.map.mutex());
+}
+
+/* Points are split into chunks of chunk_size between workers of the pool
+ * if one is specified and located in the calling thread otherwise. */
+template <class Index, class... Options>
+static py::tuple locate_points(const Index& index,
+                               const CoordinatesArray& points,
+                               ThreadPool* pool, std::size_t chunk_size,
+                               Options... options) {
+  if (points.ndim() != 2 || points.shape(1) != 2)
+    throw std::invalid_argument("Points should have shape (N, 2).");
+  py::ssize_t count = points.shape(0);
+  py::array_t<std::int64_t> indices(count);
+  py::array_t<std::uint8_t> kinds(count);
+  const double* coordinates = points.data();
+  std::int64_t* indices_data = indices.mutable_data();
+  std::uint8_t* kinds_data = kinds.mutable_data();
+  {
+    py::gil_scoped_release release;
+    // Taken without the GIL and released before reacquiring it,
+    // so the thread editing the map with the GIL does not deadlock.
+    SharedLock lock = lock_shared(index);
+    if (pool == nullptr)
+      index.locate(coordinates, static_cast<std::size_t>(count), indices_data,
+                   kinds_data, options...);
+    else
+      pool->for_each_chunk(
+          static_cast<std::size_t>(count), chunk_size,
+          [&](std::size_t begin, std::size_t end) {
+            index.locate(coordinates + 2 * begin, end - begin,
+                         indices_data + begin, kinds_data + begin,
+                         options...);
+          });
+  }
+  return py::make_tuple(indices, kinds);
+}
+
+static py::array_t<std::uint64_t> to_array(
+    const std::vector<std::size_t>& values) {
+  py::array_t<std::uint64_t> result(static_cast<py::ssize_t>(values.size()));
+  std::copy(values.begin(), values.end(), result.mutable_data());
+  return result;
+}
+
+static py::dict to_dict(const TrapezoidalMap::BuildProfile::Stage& stage) {
+  py::dict result;
+  result["calls"] = stage.calls;
+  result["seconds"] = stage.seconds;
+  return result;
 }
 
 PYBIND11_MODULE(MODULE_NAME, m) {
@@ -321,6 +934,345 @@ PYBIND11_MODULE(MODULE_NAME, m) {
         return node_to_proxy(TrapezoidalMap{contour, shuffle}.root());
       },
       py::arg("contour"), py::arg("shuffle"));
+  m.def(
+      "build_graph",
+      [](const std::vector<std::vector<Point>>& rings, bool shuffle) {
+        std::vector<Point> points;
+        std::vector<std::size_t> rings_offsets;
+        flatten_rings(rings, points, rings_offsets);
+        return node_to_proxy(
+            TrapezoidalMap{points, rings_offsets, shuffle}.root());
+      },
+      py::arg("rings"), py::arg("shuffle"));
+
+  py::class_<ThreadPool>(m, THREAD_POOL_NAME)
+      .def(py::init<std::size_t>(), py::arg("threads_count") = 0)
+      .def_property_readonly("threads_count", &ThreadPool::threads_count);
+
+  py::class_<Locator>(m, LOCATOR_NAME)
+      .def(py::init<const NodeProxy&>(), py::arg("root"),
+           py::keep_alive<1, 2>())
+      .def("locate", locate_points<Locator>, py::arg("points"),
+           py::arg("pool") = py::none(),
+           py::arg("chunk_size") = DEFAULT_CHUNK_SIZE)
+      .def_property_readonly("trapezoids", [](const Locator& self) {
+        std::vector<TrapezoidProxy> result;
+        result.reserve(self.trapezoids().size());
+        for (const Trapezoid* trapezoid : self.trapezoids())
+          result.emplace_back(*trapezoid);
+        return result;
+      });
+
+  py::class_<TrapezoidalMap, std::shared_ptr<TrapezoidalMap>>(
+      m, TRAPEZOIDAL_MAP_NAME)
+      .def(py::init<const std::vector<Point>&, bool, bool, std::uint64_t>(),
+           py::arg("contour"), py::arg("shuffle"), py::arg("profile") = false,
+           py::arg("seed") = TrapezoidalMap::DEFAULT_SEED)
+      .def(py::init([](const std::vector<Point>& contour, int order,
+                       bool profile, std::uint64_t seed) {
+             return std::make_shared<TrapezoidalMap>(
+                 contour, to_order(order), profile, seed);
+           }),
+           py::arg("contour"), py::arg("order"), py::arg("profile") = false,
+           py::arg("seed") = TrapezoidalMap::DEFAULT_SEED)
+      .def(py::init<const std::vector<Point>&, bool, ThreadPool&,
+                    std::size_t, bool, std::uint64_t>(),
+           py::arg("contour"), py::arg("shuffle"), py::arg("pool"),
+           py::arg("slabs_count") = 0, py::arg("profile") = false,
+           py::arg("seed") = TrapezoidalMap::DEFAULT_SEED,
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init([](const std::vector<std::vector<Point>>& rings,
+                       bool shuffle, bool profile, std::uint64_t seed) {
+             std::vector<Point> points;
+             std::vector<std::size_t> rings_offsets;
+             flatten_rings(rings, points, rings_offsets);
+             return std::make_shared<TrapezoidalMap>(points, rings_offsets,
+                                                     shuffle, profile, seed);
+           }),
+           py::arg("rings"), py::arg("shuffle"), py::arg("profile") = false,
+           py::arg("seed") = TrapezoidalMap::DEFAULT_SEED)
+      .def(py::init([](const std::vector<std::vector<Point>>& rings,
+                       int order, bool profile, std::uint64_t seed) {
+             std::vector<Point> points;
+             std::vector<std::size_t> rings_offsets;
+             flatten_rings(rings, points, rings_offsets);
+             return std::make_shared<TrapezoidalMap>(
+                 points, rings_offsets, to_order(order), profile, seed);
+           }),
+           py::arg("rings"), py::arg("order"), py::arg("profile") = false,
+           py::arg("seed") = TrapezoidalMap::DEFAULT_SEED)
+      .def_static(
+          "from_segments",
+          [](const std::vector<Point>& points,
+             const std::vector<TrapezoidalMap::Segment>& segments,
+             bool shuffle, const std::vector<TrapezoidalMap::Faces>& faces,
+             bool profile, std::uint64_t seed) {
+            return std::make_shared<TrapezoidalMap>(points, segments, faces,
+                                                    shuffle, profile, seed);
+          },
+          py::arg("points"), py::arg("segments"), py::arg("shuffle"),
+          py::arg("faces") = std::vector<TrapezoidalMap::Faces>(),
+          py::arg("profile") = false,
+          py::arg("seed") = TrapezoidalMap::DEFAULT_SEED)
+      .def_static(
+          "build_shallowest",
+          [](const std::vector<Point>& contour, std::size_t candidates_count,
+             std::uint64_t seed, double depth_factor, ThreadPool* pool) {
+            std::vector<std::size_t> rings_offsets;
+            if (!contour.empty()) rings_offsets.push_back(0);
+            return std::shared_ptr<TrapezoidalMap>(
+                TrapezoidalMap::build_shallowest(contour, rings_offsets,
+                                                 candidates_count, seed,
+                                                 depth_factor, pool));
+          },
+          py::arg("contour"), py::arg("candidates_count"),
+          py::arg("seed") = TrapezoidalMap::DEFAULT_SEED,
+          py::arg("depth_factor") = 0., py::arg("pool") = py::none(),
+          py::call_guard<py::gil_scoped_release>())
+      .def_static(
+          "build_shallowest",
+          [](const std::vector<std::vector<Point>>& rings,
+             std::size_t candidates_count, std::uint64_t seed,
+             double depth_factor, ThreadPool* pool) {
+            std::vector<Point> points;
+            std::vector<std::size_t> rings_offsets;
+            flatten_rings(rings, points, rings_offsets);
+            return std::shared_ptr<TrapezoidalMap>(
+                TrapezoidalMap::build_shallowest(points, rings_offsets,
+                                                 candidates_count, seed,
+                                                 depth_factor, pool));
+          },
+          py::arg("rings"), py::arg("candidates_count"),
+          py::arg("seed") = TrapezoidalMap::DEFAULT_SEED,
+          py::arg("depth_factor") = 0., py::arg("pool") = py::none(),
+          py::call_guard<py::gil_scoped_release>())
+      .def_static(
+          "build_phased",
+          [](const std::vector<Point>& contour, std::uint64_t seed,
+             bool profile) {
+            std::vector<std::size_t> rings_offsets;
+            if (!contour.empty()) rings_offsets.push_back(0);
+            return std::shared_ptr<TrapezoidalMap>(TrapezoidalMap::build_phased(
+                contour, rings_offsets, seed, profile));
+          },
+          py::arg("contour"), py::arg("seed") = TrapezoidalMap::DEFAULT_SEED,
+          py::arg("profile") = false,
+          py::call_guard<py::gil_scoped_release>())
+      .def_static(
+          "build_phased",
+          [](const std::vector<std::vector<Point>>& rings, std::uint64_t seed,
+             bool profile) {
+            std::vector<Point> points;
+            std::vector<std::size_t> rings_offsets;
+            flatten_rings(rings, points, rings_offsets);
+            return std::shared_ptr<TrapezoidalMap>(TrapezoidalMap::build_phased(
+                points, rings_offsets, seed, profile));
+          },
+          py::arg("rings"), py::arg("seed") = TrapezoidalMap::DEFAULT_SEED,
+          py::arg("profile") = false,
+          py::call_guard<py::gil_scoped_release>())
+      .def("__len__",
+           [](const TrapezoidalMap& self) {
+             return self.locator().trapezoids().size();
+           })
+      .def("__getitem__",
+           [](std::shared_ptr<TrapezoidalMap> self, std::int64_t index) {
+             const auto& trapezoids = self->locator().trapezoids();
+             const auto size = static_cast<std::int64_t>(trapezoids.size());
+             if (index < 0) index += size;
+             if (index < 0 || index >= size)
+               throw py::index_error("Trapezoid index out of range.");
+             return TrapezoidView(self, *trapezoids[index]);
+           })
+      .def_property_readonly("root",
+                             [](std::shared_ptr<TrapezoidalMap> self) {
+                               return to_node_view(self, self->root());
+                             })
+      .def("freeze",
+           [](const TrapezoidalMap& self) { return FrozenMap(self.root()); })
+      .def("save", &TrapezoidalMap::save, py::arg("path"))
+      .def_static(
+          "load",
+          [](const std::string& path) {
+            return std::shared_ptr<TrapezoidalMap>(TrapezoidalMap::load(path));
+          },
+          py::arg("path"))
+      .def("locate",
+           [](const TrapezoidalMap& self, const CoordinatesArray& points,
+              ThreadPool* pool, std::size_t chunk_size) {
+             return locate_points(MapLocator{self, self.locator()}, points,
+                                  pool, chunk_size);
+           },
+           py::arg("points"), py::arg("pool") = py::none(),
+           py::arg("chunk_size") = DEFAULT_CHUNK_SIZE)
+      .def("locate_rings",
+           [](const TrapezoidalMap& self, const CoordinatesArray& points,
+              ThreadPool* pool, std::size_t chunk_size) {
+             return locate_points(RingsLocator{self}, points, pool,
+                                  chunk_size);
+           },
+           py::arg("points"), py::arg("pool") = py::none(),
+           py::arg("chunk_size") = DEFAULT_CHUNK_SIZE)
+      .def("locate_faces",
+           [](const TrapezoidalMap& self, const CoordinatesArray& points,
+              ThreadPool* pool, std::size_t chunk_size) {
+             return locate_points(FacesLocator{self}, points, pool,
+                                  chunk_size);
+           },
+           py::arg("points"), py::arg("pool") = py::none(),
+           py::arg("chunk_size") = DEFAULT_CHUNK_SIZE)
+      .def_property_readonly("rings_count", &TrapezoidalMap::rings_count)
+      .def("insert_edge", &TrapezoidalMap::insert_edge, py::arg("start"),
+           py::arg("end"),
+           py::arg("faces") = TrapezoidalMap::Faces(-1, -1))
+      .def("insert_contour", &TrapezoidalMap::insert_contour,
+           py::arg("contour"))
+      .def("erase_edge", &TrapezoidalMap::erase_edge, py::arg("segment"))
+      .def("stats", &TrapezoidalMap::stats)
+      .def_property_readonly("is_profiled", &TrapezoidalMap::is_profiled)
+      .def("build_profile",
+           [](const TrapezoidalMap& self) {
+             TrapezoidalMap::BuildProfile profile = self.build_profile();
+             py::dict result;
+             result["search_edge"] = to_dict(profile.search_edge);
+             result["find_trapezoids"] = to_dict(profile.find_trapezoids);
+             result["allocate_trapezoids"] =
+                 to_dict(profile.allocate_trapezoids);
+             result["allocate_nodes"] = to_dict(profile.allocate_nodes);
+             result["replace_nodes"] = to_dict(profile.replace_nodes);
+             result["crossed_trapezoids_counts"] =
+                 to_array(profile.crossed_trapezoids_counts);
+             result["trapezoids_bytes"] = profile.trapezoids_bytes;
+             result["nodes_bytes"] = profile.nodes_bytes;
+             result["arena_bytes"] = profile.arena_bytes;
+             return result;
+           })
+      .def("profile_search",
+           [](const TrapezoidalMap& self, const CoordinatesArray& points) {
+             if (points.ndim() != 2 || points.shape(1) != 2)
+               throw std::invalid_argument("Points should have shape (N, 2).");
+             SearchProfile result(self.root());
+             py::gil_scoped_release release;
+             SharedLock lock(self.mutex());
+             result.search(points.data(),
+                           static_cast<std::size_t>(points.shape(0)));
+             return result;
+           },
+           py::arg("points"))
+      .def("search_point",
+           [](std::shared_ptr<TrapezoidalMap> self, const Point& point) {
+             return to_node_view(self, *self->root().search(point));
+           },
+           py::arg("point"))
+      .def("search_edge",
+           [](std::shared_ptr<TrapezoidalMap> self,
+              const EdgeProxy& edge) -> py::object {
+             Trapezoid* result = self->root().search(edge);
+             if (result == nullptr) return py::none();
+             return py::cast(TrapezoidView(self, *result));
+           },
+           py::arg("edge"));
+
+  py::class_<TrapezoidalMap::Stats>(m, TRAPEZOIDAL_MAP_STATS_NAME)
+      .def_readonly("x_nodes_count", &TrapezoidalMap::Stats::x_nodes_count)
+      .def_readonly("y_nodes_count", &TrapezoidalMap::Stats::y_nodes_count)
+      .def_readonly("leaves_count", &TrapezoidalMap::Stats::leaves_count)
+      .def_readonly("shared_nodes_count",
+                    &TrapezoidalMap::Stats::shared_nodes_count)
+      .def_readonly("parents_links_count",
+                    &TrapezoidalMap::Stats::parents_links_count)
+      .def_readonly("max_leaf_depth", &TrapezoidalMap::Stats::max_leaf_depth)
+      .def_readonly("average_leaf_depth",
+                    &TrapezoidalMap::Stats::average_leaf_depth)
+      .def_readonly("nodes_bytes", &TrapezoidalMap::Stats::nodes_bytes)
+      .def_readonly("trapezoids_bytes",
+                    &TrapezoidalMap::Stats::trapezoids_bytes)
+      .def_readonly("points_bytes", &TrapezoidalMap::Stats::points_bytes)
+      .def_readonly("edges_bytes", &TrapezoidalMap::Stats::edges_bytes);
+
+  py::class_<SearchProfile>(m, SEARCH_PROFILE_NAME)
+      .def_property_readonly("x_nodes_steps",
+                             [](const SearchProfile& self) {
+                               return to_array(self.x_nodes_steps());
+                             })
+      .def_property_readonly("y_nodes_steps",
+                             [](const SearchProfile& self) {
+                               return to_array(self.y_nodes_steps());
+                             })
+      .def_property_readonly("depths_histogram",
+                             [](const SearchProfile& self) {
+                               return to_array(self.depths_histogram());
+                             })
+      .def_property_readonly("visits_counts",
+                             [](const SearchProfile& self) {
+                               return to_array(self.visits_counts());
+                             })
+      .def("summary", [](const SearchProfile& self) {
+        SearchProfile::Summary summary = self.summary();
+        py::dict result;
+        result["queries_count"] = summary.queries_count;
+        result["x_nodes_steps"] = summary.x_nodes_steps;
+        result["y_nodes_steps"] = summary.y_nodes_steps;
+        result["max_depth"] = summary.max_depth;
+        result["average_depth"] = summary.average_depth;
+        result["visited_nodes_count"] = summary.visited_nodes_count;
+        return result;
+      });
+
+  py::class_<FrozenMap>(m, FROZEN_MAP_NAME)
+      .def(py::init<const NodeProxy&>(), py::arg("root"))
+      .def("__len__", &FrozenMap::trapezoids_count)
+      .def("locate", locate_points<FrozenMap, bool>, py::arg("points"),
+           py::arg("pool") = py::none(),
+           py::arg("chunk_size") = DEFAULT_CHUNK_SIZE,
+           py::arg("lockstep") = false)
+      .def_static("has_lockstep_kernel", &FrozenMap::has_lockstep_kernel)
+      .def("save", &FrozenMap::save, py::arg("path"))
+      .def_static("attach", &FrozenMap::attach, py::arg("path"))
+      .def_property_readonly("edges_count", &FrozenMap::edges_count)
+      .def_property_readonly("nodes_count", &FrozenMap::nodes_count)
+      .def_property_readonly("points_count", &FrozenMap::points_count);
+
+  py::class_<TrapezoidView>(m, TRAPEZOID_VIEW_NAME)
+      .def(py::self == py::self)
+      .def_property_readonly("left", &TrapezoidView::left)
+      .def_property_readonly("right", &TrapezoidView::right)
+      .def_property_readonly("below", &TrapezoidView::below)
+      .def_property_readonly("above", &TrapezoidView::above)
+      .def_property_readonly("face", &TrapezoidView::face)
+      .def_property_readonly("ring", &TrapezoidView::ring)
+      .def_property_readonly("lower_left", &TrapezoidView::lower_left)
+      .def_property_readonly("lower_right", &TrapezoidView::lower_right)
+      .def_property_readonly("upper_left", &TrapezoidView::upper_left)
+      .def_property_readonly("upper_right", &TrapezoidView::upper_right)
+      .def_property_readonly("trapezoid_node", &TrapezoidView::trapezoid_node)
+      .def("to_proxy", &TrapezoidView::to_proxy);
+
+  py::class_<NodeView>(m, NODE_VIEW_NAME)
+      .def(py::self == py::self)
+      .def_property_readonly("parents", &NodeView::parents)
+      .def("search_point", &NodeView::search_point, py::arg("point"))
+      .def("to_proxy", &NodeView::to_proxy);
+
+  py::class_<XNodeView, NodeView>(m, X_NODE_VIEW_NAME)
+      .def_property_readonly("point", &XNodeView::point)
+      .def_property_readonly("left", &XNodeView::left)
+      .def_property_readonly("right", &XNodeView::right);
+
+  py::class_<YNodeView, NodeView>(m, Y_NODE_VIEW_NAME)
+      .def_property_readonly("edge", &YNodeView::edge)
+      .def_property_readonly("below", &YNodeView::below)
+      .def_property_readonly("above", &YNodeView::above);
+
+  py::class_<LeafView, NodeView>(m, LEAF_VIEW_NAME)
+      .def_property_readonly("trapezoid", &LeafView::trapezoid);
+
+  m.attr("KIND_TRAPEZOID") = static_cast<int>(Locator::Kind_Trapezoid);
+  m.attr("KIND_POINT") = static_cast<int>(Locator::Kind_Point);
+  m.attr("KIND_EDGE") = static_cast<int>(Locator::Kind_Edge);
+  m.attr("ORDER_INPUT") = static_cast<int>(TrapezoidalMap::Order_Input);
+  m.attr("ORDER_SHUFFLE") = static_cast<int>(TrapezoidalMap::Order_Shuffle);
+  m.attr("ORDER_BRIO") = static_cast<int>(TrapezoidalMap::Order_Brio);
 
   py::class_<Point>(m, POINT_NAME)
       .def(py::init<double, double>(), py::arg("x") = 0., py::arg("y") = 0.)
@@ -419,7 +1371,50 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                     &TrapezoidProxy::set_upper_right);
 
   py::class_<NodeProxy>(m, "Node")
-      .def_readonly("parents", &NodeProxy::parents)
+      .def("__reduce_ex__",
+           [](const NodeProxy& self, int protocol) {
+             std::vector<char> bytes = graph_to_bytes(self);
+             // Protocol 5 allows the buffer to be passed out-of-band,
+             // so it is exposed without copying.
+             py::object data;
+             if (protocol >= 5)
+               data = py::module::import("pickle").attr("PickleBuffer")(
+                   to_bytes_array(std::move(bytes)));
+             else
+               data = py::bytes(bytes.data(), bytes.size());
+             return py::make_tuple(py::module::import(C_STR(MODULE_NAME))
+                                       .attr("Node")
+                                       .attr("from_bytes"),
+                                   py::make_tuple(data));
+           },
+           py::arg("protocol"))
+      .def("to_bytes",
+           [](const NodeProxy& self) {
+             const std::vector<char> bytes = graph_to_bytes(self);
+             return py::bytes(bytes.data(), bytes.size());
+           })
+      .def_static(
+          "from_bytes",
+          [](py::buffer data) {
+            // Data is read in place from any C-contiguous buffer.
+            py::buffer_info info = data.request();
+            py::ssize_t stride = info.itemsize;
+            for (py::ssize_t axis = info.ndim; axis-- > 0;) {
+              if (info.shape[axis] > 1 && info.strides[axis] != stride)
+                throw std::invalid_argument("Data should be contiguous.");
+              stride *= info.shape[axis];
+            }
+            return graph_from_bytes(static_cast<const char*>(info.ptr),
+                                    info.size * info.itemsize);
+          },
+          py::arg("data"), py::return_value_policy::reference)
+      .def_property_readonly("parents",
+                             [](const NodeProxy& self) {
+                               std::vector<NodeProxy*> result;
+                               for (Node* parent : self.get_parents())
+                                 result.push_back(cast_node_to_proxy(parent));
+                               return result;
+                             })
       .def("replace_child",
            [](NodeProxy& self, NodeProxy* current, NodeProxy* replacement) {
              self.replace_child(current, replacement);
@@ -442,16 +1437,6 @@ PYBIND11_MODULE(MODULE_NAME, m) {
       m, X_NODE_NAME)
       .def(py::init<const Point&, NodeProxy*, NodeProxy*>(), py::arg("point"),
            py::arg("left").none(false), py::arg("right").none(false))
-      .def(py::pickle(
-          [](const XNode& self) {  // __getstate__
-            return py::make_tuple(self.point, self.left(), self.right());
-          },
-          [](py::tuple tuple) {  // __setstate__
-            if (tuple.size() != 3) throw std::runtime_error("Invalid state!");
-            return new XNode(tuple[0].cast<const Point&>(),
-                             tuple[1].cast<NodeProxy*>(),
-                             tuple[2].cast<NodeProxy*>());
-          }))
       .def(py::self == py::self)
       .def("__repr__", repr<XNode>)
       .def_readonly("point", &XNode::point)
@@ -463,16 +1448,6 @@ PYBIND11_MODULE(MODULE_NAME, m) {
       .def(py::init<const EdgeProxy&, NodeProxy*, NodeProxy*>(),
            py::arg("edge"), py::arg("below").none(false),
            py::arg("above").none(false))
-      .def(py::pickle(
-          [](const YNode& self) {  // __getstate__
-            return py::make_tuple(self.edge, self.below(), self.above());
-          },
-          [](py::tuple tuple) {  // __setstate__
-            if (tuple.size() != 3) throw std::runtime_error("Invalid state!");
-            return new YNode(tuple[0].cast<const EdgeProxy&>(),
-                             tuple[1].cast<NodeProxy*>(),
-                             tuple[2].cast<NodeProxy*>());
-          }))
       .def(py::self == py::self)
       .def("__repr__", repr<YNode>)
       .def_readonly("edge", &YNode::edge)
@@ -481,13 +1456,6 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   py::class_<Leaf, NodeProxy, std::unique_ptr<Leaf, py::nodelete>>(m, LEAF_NAME)
       .def(py::init<const TrapezoidProxy&>(), py::arg("trapezoid"))
-      .def(py::pickle(
-          [](const Leaf& self) {  // __getstate__
-            return self.trapezoid();
-          },
-          [](const TrapezoidProxy& trapezoid) {  // __setstate__
-            return new Leaf(trapezoid);
-          }))
       .def(py::self == py::self)
       .def("__repr__", repr<Leaf>)
       .def_property_readonly("trapezoid", &Leaf::trapezoid);
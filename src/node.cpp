@@ -1,8 +1,10 @@
 #include "node.h"
 
-#include <algorithm>
 #include <cassert>
+#include <unordered_set>
+#include <utility>
 
+#include "search_profile.h"
 #include "trapezoid.h"
 
 Node::Node(const Point* point, Node* left, Node* right) : type(Type_XNode) {
@@ -33,67 +35,111 @@ Node::Node(Trapezoid* trapezoid) : type(Type_TrapezoidNode) {
   trapezoid->trapezoid_node = this;
 }
 
-Node::~Node() {
-  switch (type) {
-    case Type_XNode:
-      if (data.xnode.left->remove_parent(this)) delete data.xnode.left;
-      if (data.xnode.right->remove_parent(this)) delete data.xnode.right;
-      break;
-    case Type_YNode:
-      if (data.ynode.below->remove_parent(this)) delete data.ynode.below;
-      if (data.ynode.above->remove_parent(this)) delete data.ynode.above;
-      break;
-    case Type_TrapezoidNode:
-      delete data.trapezoid;
-      break;
-  }
-}
-
 void Node::add_parent(Node* parent) {
   assert(parent != nullptr && "Null parent");
   assert(parent != this && "Cannot be parent of self");
   assert(!has_parent(parent) && "Parent already in collection");
-  parents.push_back(parent);
+  for (ParentEntry& entry : parent->_parent_entries)
+    if (parent->get_child(&entry - parent->_parent_entries) == this &&
+        !is_linked(entry)) {
+      link(entry);
+      return;
+    }
+  assert(0 && "Not a child of the parent");
 }
 
 void Node::assert_valid() const {
 #ifndef NDEBUG
-  // Check parents.
-  for (Parents::const_iterator it = parents.begin(); it != parents.end();
-       ++it) {
-    Node* parent = *it;
-    assert(parent != this && "Cannot be parent of self");
-    assert(parent->has_child(this) && "Parent missing child");
-  }
+  // Each Node of the search graph is checked once, without recursion.
+  for (const Node* node : collect_nodes()) {
+    // Check parents.
+    for (const ParentEntry* entry = node->_first_parent; entry != nullptr;
+         entry = entry->next) {
+      Node* parent = entry->parent;
+      assert(parent != node && "Cannot be parent of self");
+      assert(parent->has_child(node) && "Parent missing child");
+    }
 
-  // Check children, and recurse.
-  switch (type) {
-    case Type_XNode:
-      assert(data.xnode.left != nullptr && "Null left child");
-      assert(data.xnode.left->has_parent(this) && "Incorrect parent");
-      assert(data.xnode.right != nullptr && "Null right child");
-      assert(data.xnode.right->has_parent(this) && "Incorrect parent");
-      data.xnode.left->assert_valid();
-      data.xnode.right->assert_valid();
-      break;
-    case Type_YNode:
-      assert(data.ynode.below != nullptr && "Null below child");
-      assert(data.ynode.below->has_parent(this) && "Incorrect parent");
-      assert(data.ynode.above != nullptr && "Null above child");
-      assert(data.ynode.above->has_parent(this) && "Incorrect parent");
-      data.ynode.below->assert_valid();
-      data.ynode.above->assert_valid();
-      break;
-    case Type_TrapezoidNode:
-      assert(data.trapezoid != nullptr && "Null trapezoid");
-      assert(data.trapezoid->trapezoid_node == this &&
-             "Incorrect trapezoid node");
-      data.trapezoid->assert_valid();
-      break;
+    // Check children.
+    switch (node->type) {
+      case Type_XNode:
+        assert(node->data.xnode.left != nullptr && "Null left child");
+        assert(node->data.xnode.left->has_parent(node) && "Incorrect parent");
+        assert(node->data.xnode.right != nullptr && "Null right child");
+        assert(node->data.xnode.right->has_parent(node) &&
+               "Incorrect parent");
+        break;
+      case Type_YNode:
+        assert(node->data.ynode.below != nullptr && "Null below child");
+        assert(node->data.ynode.below->has_parent(node) &&
+               "Incorrect parent");
+        assert(node->data.ynode.above != nullptr && "Null above child");
+        assert(node->data.ynode.above->has_parent(node) &&
+               "Incorrect parent");
+        break;
+      case Type_TrapezoidNode:
+        assert(node->data.trapezoid != nullptr && "Null trapezoid");
+        assert(node->data.trapezoid->trapezoid_node == node &&
+               "Incorrect trapezoid node");
+        node->data.trapezoid->assert_valid();
+        break;
+    }
   }
 #endif
 }
 
+std::vector<const Node*> Node::collect_nodes() const {
+  std::vector<const Node*> result;
+  std::unordered_set<const Node*> visited;
+  std::vector<const Node*> stack{this};
+  while (!stack.empty()) {
+    const Node* node = stack.back();
+    stack.pop_back();
+    if (!visited.insert(node).second) continue;
+    result.push_back(node);
+    // Children are pushed in reverse order to be popped left/below first.
+    switch (node->type) {
+      case Type_XNode:
+        stack.push_back(node->data.xnode.right);
+        stack.push_back(node->data.xnode.left);
+        break;
+      case Type_YNode:
+        stack.push_back(node->data.ynode.above);
+        stack.push_back(node->data.ynode.below);
+        break;
+      case Type_TrapezoidNode:
+        break;
+    }
+  }
+  return result;
+}
+
+std::vector<const Node*> Node::collect_nodes_bottom_up() const {
+  std::vector<const Node*> result;
+  std::unordered_set<const Node*> visited;
+  // Nodes are revisited after their children to be reported.
+  std::vector<std::pair<const Node*, bool>> stack(1, {this, false});
+  while (!stack.empty()) {
+    const Node* node = stack.back().first;
+    bool expanded = stack.back().second;
+    stack.pop_back();
+    if (expanded || node->type == Type_TrapezoidNode) {
+      if (visited.insert(node).second) result.push_back(node);
+      continue;
+    }
+    if (visited.count(node)) continue;
+    stack.emplace_back(node, true);
+    if (node->type == Type_XNode) {
+      stack.emplace_back(node->data.xnode.right, false);
+      stack.emplace_back(node->data.xnode.left, false);
+    } else {
+      stack.emplace_back(node->data.ynode.above, false);
+      stack.emplace_back(node->data.ynode.below, false);
+    }
+  }
+  return result;
+}
+
 bool Node::has_child(const Node* child) const {
   assert(child != nullptr && "Null child node");
   switch (type) {
@@ -106,118 +152,230 @@ bool Node::has_child(const Node* child) const {
   }
 }
 
+std::vector<Node*> Node::get_parents() const {
+  std::vector<Node*> result;
+  for (const ParentEntry* entry = _first_parent; entry != nullptr;
+       entry = entry->next)
+    result.push_back(entry->parent);
+  return result;
+}
+
+Node* Node::get_child(std::size_t slot) const {
+  switch (type) {
+    case Type_XNode:
+      return slot == 0 ? data.xnode.left : data.xnode.right;
+    case Type_YNode:
+      return slot == 0 ? data.ynode.below : data.ynode.above;
+    default:  // Type_TrapezoidNode:
+      return nullptr;
+  }
+}
+
 bool Node::has_parent(const Node* parent) const {
-  return (std::find(parents.begin(), parents.end(), parent) != parents.end());
+  for (const ParentEntry& entry : parent->_parent_entries)
+    if (parent->get_child(&entry - parent->_parent_entries) == this &&
+        is_linked(entry))
+      return true;
+  return false;
+}
+
+bool Node::is_linked(const ParentEntry& entry) const {
+  return entry.previous != nullptr || _first_parent == &entry;
+}
+
+void Node::link(ParentEntry& entry) {
+  entry.previous = _last_parent;
+  entry.next = nullptr;
+  if (_last_parent != nullptr)
+    _last_parent->next = &entry;
+  else
+    _first_parent = &entry;
+  _last_parent = &entry;
+}
+
+void Node::unlink(ParentEntry& entry) {
+  if (entry.previous != nullptr)
+    entry.previous->next = entry.next;
+  else
+    _first_parent = entry.next;
+  if (entry.next != nullptr)
+    entry.next->previous = entry.previous;
+  else
+    _last_parent = entry.previous;
+  entry.previous = entry.next = nullptr;
 }
 
 bool Node::remove_parent(Node* parent) {
   assert(parent != nullptr && "Null parent");
   assert(parent != this && "Cannot be parent of self");
-  Parents::iterator it = std::find(parents.begin(), parents.end(), parent);
-  assert(it != parents.end() && "Parent not in collection");
-  parents.erase(it);
-  return parents.empty();
+  assert(has_parent(parent) && "Parent not in collection");
+  for (ParentEntry& entry : parent->_parent_entries)
+    if (parent->get_child(&entry - parent->_parent_entries) == this &&
+        is_linked(entry)) {
+      unlink(entry);
+      break;
+    }
+  return !has_parents();
 }
 
 void Node::replace_child(Node* old_child, Node* new_child) {
+  assert(new_child != nullptr && "Null child node");
+  assert(!new_child->has_parent(this) && "Parent already in collection");
+  std::size_t slot = 0;
   switch (type) {
     case Type_XNode:
       assert((data.xnode.left == old_child || data.xnode.right == old_child) &&
              "Not a child Node");
-      assert(new_child != nullptr && "Null child node");
-      if (data.xnode.left == old_child)
-        data.xnode.left = new_child;
-      else
-        data.xnode.right = new_child;
+      slot = data.xnode.left == old_child ? 0 : 1;
       break;
     case Type_YNode:
       assert((data.ynode.below == old_child || data.ynode.above == old_child) &&
              "Not a child node");
-      assert(new_child != nullptr && "Null child node");
-      if (data.ynode.below == old_child)
-        data.ynode.below = new_child;
-      else
-        data.ynode.above = new_child;
+      slot = data.ynode.below == old_child ? 0 : 1;
       break;
     case Type_TrapezoidNode:
       assert(0 && "Invalid type for this operation");
-      break;
+      return;
   }
-  old_child->remove_parent(this);
-  new_child->add_parent(this);
+  // Entry is moved from the parents list of the old child to the new one.
+  ParentEntry& entry = _parent_entries[slot];
+  assert(old_child->is_linked(entry) && "Parent not in collection");
+  old_child->unlink(entry);
+  if (type == Type_XNode)
+    (slot == 0 ? data.xnode.left : data.xnode.right) = new_child;
+  else
+    (slot == 0 ? data.ynode.below : data.ynode.above) = new_child;
+  new_child->link(entry);
 }
 
 void Node::replace_with(Node* new_node) {
   assert(new_node != nullptr && "Null replacement node");
   // Replace child of each parent with new_node.  As each has parent has its
   // child replaced it is removed from the parents collection.
-  while (!parents.empty()) parents.front()->replace_child(this, new_node);
+  while (_first_parent != nullptr)
+    _first_parent->parent->replace_child(this, new_node);
 }
 
-const Node* Node::search(const Point& xy) const {
-  switch (type) {
-    case Type_XNode:
-      if (xy == *data.xnode.point)
-        return this;
-      else if (xy.is_right_of(*data.xnode.point))
-        return data.xnode.right->search(xy);
-      else
-        return data.xnode.left->search(xy);
-    case Type_YNode: {
-      int orient = data.ynode.edge->get_point_orientation(xy);
-      if (orient == 0)
-        return this;
-      else if (orient < 0)
-        return data.ynode.above->search(xy);
-      else
-        return data.ynode.below->search(xy);
-    }
-    default:  // Type_TrapezoidNode:
-      return this;
+void Node::take_over(Node& node) {
+  assert(type == Type_TrapezoidNode && "Node should have no children");
+  assert(!node.has_parents() && "Node should have no parents");
+  type = node.type;
+  erased = node.erased;
+  data = node.data;
+  for (std::size_t slot = 0; slot < 2; ++slot) {
+    Node* child = get_child(slot);
+    if (child == nullptr) continue;
+    // Entry takes the place of the one of the node in the parents list,
+    // so the order of parents is kept.
+    ParentEntry& entry = _parent_entries[slot];
+    ParentEntry& replaced = node._parent_entries[slot];
+    entry.previous = replaced.previous;
+    entry.next = replaced.next;
+    (entry.previous != nullptr ? entry.previous->next : child->_first_parent) =
+        &entry;
+    (entry.next != nullptr ? entry.next->previous : child->_last_parent) =
+        &entry;
+    replaced.previous = replaced.next = nullptr;
   }
+  node.type = Type_TrapezoidNode;
+  node.data.trapezoid = nullptr;
 }
 
-Trapezoid* Node::search(const Edge& edge) const {
-  switch (type) {
-    case Type_XNode:
-      if (edge.left == data.xnode.point)
-        return data.xnode.right->search(edge);
-      else {
-        if (edge.left->is_right_of(*data.xnode.point))
-          return data.xnode.right->search(edge);
+// Tracer of searches which ignores passed nodes, so it is compiled away.
+struct NullTracer {
+  void visit(const Node&) {}
+};
+
+template <class Tracer>
+static const Node* search_point(const Node* node, const Point& xy,
+                                Tracer& tracer) {
+  while (true) {
+    tracer.visit(*node);
+    switch (node->type) {
+      case Node::Type_XNode:
+        if (xy == *node->data.xnode.point && !node->erased)
+          return node;
+        else if (xy.is_right_of(*node->data.xnode.point))
+          node = node->data.xnode.right;
+        else
+          node = node->data.xnode.left;
+        break;
+      case Node::Type_YNode: {
+        int orient = node->data.ynode.edge->get_point_orientation(xy);
+        if (orient == 0 && !node->erased)
+          return node;
+        else if (orient < 0)
+          node = node->data.ynode.above;
         else
-          return data.xnode.left->search(edge);
+          node = node->data.ynode.below;
+        break;
       }
-    case Type_YNode:
-      if (edge.left == data.ynode.edge->left) {
-        // Coinciding left edge points.
-        if (edge.get_slope() == data.ynode.edge->get_slope()) {
-          return nullptr;
+      default:  // Type_TrapezoidNode:
+        return node;
+    }
+  }
+}
+
+const Node* Node::search(const Point& xy) const {
+  NullTracer tracer;
+  return search_point(this, xy, tracer);
+}
+
+const Node* Node::search(const Point& xy, SearchProfile& profile) const {
+  return search_point(this, xy, profile);
+}
+
+Trapezoid* Node::search(const Edge& edge) const {
+  return search(edge, nullptr, false);
+}
+
+Trapezoid* Node::search_adjacent(const Edge& edge, bool above) const {
+  return search(edge, &edge, above);
+}
+
+Trapezoid* Node::search(const Edge& edge, const Edge* adjacent,
+                        bool above) const {
+  const Node* node = this;
+  while (true) {
+    switch (node->type) {
+      case Type_XNode:
+        if (edge.left == node->data.xnode.point)
+          node = node->data.xnode.right;
+        else {
+          if (edge.left->is_right_of(*node->data.xnode.point))
+            node = node->data.xnode.right;
+          else
+            node = node->data.xnode.left;
         }
-        if (edge.get_slope() > data.ynode.edge->get_slope())
-          return data.ynode.above->search(edge);
-        else
-          return data.ynode.below->search(edge);
-      } else if (edge.right == data.ynode.edge->right) {
-        // Coinciding right edge points.
-        if (edge.get_slope() == data.ynode.edge->get_slope()) {
-          return nullptr;
+        break;
+      case Type_YNode: {
+        const Edge& node_edge = *node->data.ynode.edge;
+        if (&node_edge == adjacent) {
+          node = above ? node->data.ynode.above : node->data.ynode.below;
+          break;
         }
-        if (edge.get_slope() > data.ynode.edge->get_slope())
-          return data.ynode.below->search(edge);
+        /* With coinciding left edge points the edge is compared by its right
+         * point, which is the same as comparison of slopes but exact.
+         * Edge clipped by the left boundary of a slab map can start
+         * before the node edge, then it is compared with the left point
+         * of the node edge instead. */
+        int orient;
+        if (edge.left == node_edge.left)
+          orient = node_edge.get_point_orientation(*edge.right);
+        else if (node_edge.left->is_right_of(*edge.left))
+          orient = -edge.get_point_orientation(*node_edge.left);
         else
-          return data.ynode.above->search(edge);
-      } else {
-        int orient = data.ynode.edge->get_point_orientation(*edge.left);
-        if (orient == 0) {
-          return nullptr;
-        }
+          orient = node_edge.get_point_orientation(*edge.left);
+        // Edge can lie along an erased one, but not along an existing one.
+        if (orient == 0 && !node->erased) return nullptr;
         if (orient < 0)
-          return data.ynode.above->search(edge);
+          node = node->data.ynode.above;
         else
-          return data.ynode.below->search(edge);
+          node = node->data.ynode.below;
+        break;
       }
-    default:  // Type_TrapezoidNode:
-      return data.trapezoid;
+      default:  // Type_TrapezoidNode:
+        return node->data.trapezoid;
+    }
   }
 }
@@ -1,13 +1,15 @@
 #ifndef NODE_H
 #define NODE_H
 
-#include <list>
+#include <cstddef>
 #include <set>
+#include <vector>
 
 #include "edge.h"
 #include "point.h"
 
-struct Trapezoid;  // Forward declaration.
+class SearchProfile;  // Forward declaration.
+struct Trapezoid;     // Forward declaration.
 
 /* Node of the trapezoid map search graph.
  * There are 3 possible types: Type_XNode, Type_YNode and Type_TrapezoidNode.
@@ -19,23 +21,43 @@ struct Trapezoid;  // Forward declaration.
  * multiple times without having to create duplicate identical Nodes.
  * The parent collection acts as a reference count to the number of times
  * a Node occurs in the search graph. When the parent count is reduced to
- * zero a Node can be safely deleted. */
+ * zero a Node can be safely destroyed.
+ * Parents are kept in an intrusive doubly linked list whose entries are
+ * stored in the parents themselves (one per child), so adding and removing
+ * a parent takes constant time and allocates no memory.
+ * Nodes do not own their children and Trapezoids, all of them are owned
+ * by the container of the search graph.
+ * Nodes of points & edges erased from the map are kept in the graph
+ * to route the search, but are never its result. */
 class Node {
  public:
   Node(const Point* point, Node* left, Node* right);  // Type_XNode.
   Node(const Edge* edge, Node* below, Node* above);   // Type_YNode.
   Node(Trapezoid* trapezoid);                         // Type_TrapezoidNode.
 
-  virtual ~Node();
+  virtual ~Node() = default;
 
   void add_parent(Node* parent);
 
-  /* Recurse through the search graph and assert that everything is valid.
+  /* Iterate through the search graph and assert that everything is valid.
    * Reduces to a no-op if NDEBUG is defined. */
   void assert_valid() const;
 
+  /* Collect all distinct Nodes of the search graph rooted at this Node
+   * in depth-first pre-order with left/below children visited first,
+   * so that every shared Node is reported exactly once. */
+  std::vector<const Node*> collect_nodes() const;
+
+  /* Same as collect_nodes but in depth-first post-order,
+   * so children precede their parents and this Node is the last one. */
+  std::vector<const Node*> collect_nodes_bottom_up() const;
+
+  // Return parents in the order they were added.
+  std::vector<Node*> get_parents() const;
+
   bool has_child(const Node* child) const;
   bool has_parent(const Node* parent) const;
+  bool has_parents() const { return _first_parent != nullptr; }
 
   /* Remove a parent from this Node.  Return true if no parents remain
    * so that this Node can be deleted. */
@@ -46,37 +68,74 @@ class Node {
   // Replace this node with the specified new_node in all parents.
   void replace_with(Node* new_node);
 
-  /* Recursive search through the graph to find the Node containing the
+  /* Turn this TrapezoidNode into the specified Node without parents,
+   * taking over its children, so that this Node stays in place
+   * in all parents and searches started from it pass the new children.
+   * The specified Node is left as a TrapezoidNode without a Trapezoid
+   * and can be destroyed. */
+  void take_over(Node& node);
+
+  /* Iterative search through the graph to find the Node containing the
    * specified Point point. */
   const Node* search(const Point& xy) const;
 
-  /* Recursive search through the graph to find the Trapezoid containing
+  /* Same as above reporting each passed Node (including the found one)
+   * to the profile, the search without it is not instrumented at all. */
+  const Node* search(const Point& xy, SearchProfile& profile) const;
+
+  /* Iterative search through the graph to find the Trapezoid containing
    * the left endpoint of the specified Edge.  Return 0 if fails, which
    * can only happen if the triangulation is invalid. */
   Trapezoid* search(const Edge& edge) const;
 
+  /* Same as above for the Edge which is in the graph, returning
+   * the Trapezoid adjacent to it from above or from below
+   * at its left endpoint. */
+  Trapezoid* search_adjacent(const Edge& edge, bool above) const;
+
   Node(const Node& other) = delete;
   Node& operator=(const Node& other) = delete;
 
   typedef enum { Type_XNode, Type_YNode, Type_TrapezoidNode } Type;
   Type type;
+  // Whether the point or the edge of the node is erased from the map,
+  // searches for points on it continue to the left/below child.
+  bool erased = false;
 
   union {
     struct {
       const Point* point;  // Not owned.
-      Node* left;          // Owned.
-      Node* right;         // Owned.
+      Node* left;          // Not owned.
+      Node* right;         // Not owned.
     } xnode;
     struct {
       const Edge* edge;  // Not owned.
-      Node* below;       // Owned.
-      Node* above;       // Owned.
+      Node* below;       // Not owned.
+      Node* above;       // Not owned.
     } ynode;
-    Trapezoid* trapezoid;  // Owned.
+    Trapezoid* trapezoid;  // Not owned.
   } data;
 
-  typedef std::list<Node*> Parents;
-  Parents parents;  // Not owned.
+ private:
+  // Entry of the list of parents of a child, owned by the parent.
+  struct ParentEntry {
+    Node* parent;
+    ParentEntry* previous;
+    ParentEntry* next;
+  };
+
+  Trapezoid* search(const Edge& edge, const Edge* adjacent, bool above) const;
+
+  Node* get_child(std::size_t slot) const;
+  bool is_linked(const ParentEntry& entry) const;
+  void link(ParentEntry& entry);
+  void unlink(ParentEntry& entry);
+
+  // Entries of the parents lists of left/below and right/above children.
+  ParentEntry _parent_entries[2] = {{this, nullptr, nullptr},
+                                    {this, nullptr, nullptr}};
+  ParentEntry* _first_parent = nullptr;  // Not owned.
+  ParentEntry* _last_parent = nullptr;   // Not owned.
 };
 
 #endif
@@ -0,0 +1,57 @@
+#include "predicates.h"
+
+#include <cstddef>
+
+/* Exact arithmetic on expansions of J. R. Shewchuk: value is represented
+ * by the sum of components which are nonoverlapping doubles in the order
+ * of increasing magnitude, so its sign is the one of the last component. */
+
+// Sum of a & b as its rounded value and the rounding error.
+static void two_sum(double a, double b, double& sum, double& error) {
+  sum = a + b;
+  const double b_virtual = sum - a;
+  const double a_virtual = sum - b_virtual;
+  error = (a - a_virtual) + (b - b_virtual);
+}
+
+// Product of a & b as its rounded value and the rounding error.
+static void two_product(double a, double b, double& product, double& error) {
+  product = a * b;
+  error = std::fma(a, b, -product);
+}
+
+/* Add the value to the expansion of the specified size in place
+ * eliminating zero components, return the new size. */
+static std::size_t grow_expansion(double* expansion, std::size_t size,
+                                  double value) {
+  std::size_t result = 0;
+  double accumulator = value;
+  for (std::size_t index = 0; index < size; ++index) {
+    double sum, error;
+    two_sum(accumulator, expansion[index], sum, error);
+    accumulator = sum;
+    if (error != 0.) expansion[result++] = error;
+  }
+  if (accumulator != 0. || result == 0) expansion[result++] = accumulator;
+  return result;
+}
+
+int exact_orientation(const Point& point, const Point& start,
+                      const Point& end) {
+  /* Cross product expands into the sum of exact products of coordinates
+   * without differences, which are inexact by themselves:
+   * px * ey - px * sy - sx * ey - py * ex + py * sx + sy * ex. */
+  const double factors[6][2] = {
+      {point.x, end.y},    {-point.x, start.y}, {-start.x, end.y},
+      {-point.y, end.x},   {point.y, start.x},  {start.y, end.x}};
+  double expansion[12];
+  std::size_t size = 0;
+  for (const auto& pair : factors) {
+    double product, error;
+    two_product(pair[0], pair[1], product, error);
+    size = grow_expansion(expansion, size, error);
+    size = grow_expansion(expansion, size, product);
+  }
+  const double most_significant = expansion[size - 1];
+  return most_significant > 0. ? +1 : (most_significant < 0. ? -1 : 0);
+}
@@ -0,0 +1,53 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include <cmath>
+#include <limits>
+
+#include "point.h"
+
+/* Relative error bound of the floating-point evaluation of the cross
+ * product in orientation by J. R. Shewchuk, "Adaptive Precision
+ * Floating-Point Arithmetic and Fast Robust Geometric Predicates":
+ * (3 + 16 eps) eps with eps being half of the machine epsilon. */
+static const double ORIENTATION_ERROR_BOUND =
+    (3. + 8. * std::numeric_limits<double>::epsilon()) *
+    std::numeric_limits<double>::epsilon() / 2.;
+
+/* Exact sign of the z-component of the cross product
+ * of (point - start) and (end - start), called by orientation
+ * when the floating-point one is not certain. */
+int exact_orientation(const Point& point, const Point& start,
+                      const Point& end);
+
+/* Return +1 if point is to the right of (below) the line from start to end
+ * with start to the left of end, -1 if to the left of (above) it
+ * and 0 if on it, i.e. the sign of the z-component of the cross product
+ * of (point - start) and (end - start).
+ * The cross product is evaluated in floating-point and its sign is taken
+ * if its products have different signs or its magnitude exceeds
+ * the error bound, otherwise it is evaluated exactly by exact_orientation.
+ * Result is exact as long as the intermediate values stay in the range
+ * of doubles: coordinates whose differences or products overflow
+ * (e.g. beyond 1e150 in magnitude) give infinities or NaN and a wrong sign,
+ * as do products which underflow (e.g. of differences below 1e-150). */
+inline int orientation(const Point& point, const Point& start,
+                       const Point& end) {
+  const double left = (point.x - start.x) * (end.y - start.y);
+  const double right = (point.y - start.y) * (end.x - start.x);
+  const double cross_z = left - right;
+  // Rounding keeps signs of differences and products.
+  if (left > 0.) {
+    if (right <= 0.) return +1;
+  } else if (left < 0.) {
+    if (right >= 0.) return -1;
+  } else
+    return right > 0. ? -1 : (right < 0. ? +1 : 0);
+  const double bound = ORIENTATION_ERROR_BOUND * (std::fabs(left) +
+                                                  std::fabs(right));
+  if (cross_z > bound) return +1;
+  if (-cross_z > bound) return -1;
+  return exact_orientation(point, start, end);
+}
+
+#endif
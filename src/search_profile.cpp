@@ -0,0 +1,64 @@
+#include "search_profile.h"
+
+#include <algorithm>
+#include <cassert>
+
+SearchProfile::SearchProfile(const Node& root) : _root(root) {
+  const std::vector<const Node*> nodes = root.collect_nodes();
+  _indices.reserve(nodes.size());
+  for (std::size_t index = 0; index < nodes.size(); ++index)
+    _indices.emplace(nodes[index], index);
+  _visits_counts.assign(nodes.size(), 0);
+}
+
+void SearchProfile::search(const double* coordinates, std::size_t count) {
+  _x_nodes_steps.reserve(_x_nodes_steps.size() + count);
+  _y_nodes_steps.reserve(_y_nodes_steps.size() + count);
+  for (std::size_t index = 0; index < count; ++index) {
+    _x_nodes_step = _y_nodes_step = 0;
+    _root.search(Point(coordinates[2 * index], coordinates[2 * index + 1]),
+                 *this);
+    _x_nodes_steps.push_back(_x_nodes_step);
+    _y_nodes_steps.push_back(_y_nodes_step);
+    std::size_t depth = _x_nodes_step + _y_nodes_step;
+    if (depth >= _depths_histogram.size())
+      _depths_histogram.resize(depth + 1, 0);
+    ++_depths_histogram[depth];
+  }
+}
+
+void SearchProfile::visit(const Node& node) {
+  auto position = _indices.find(&node);
+  assert(position != _indices.end() && "Node is not indexed");
+  ++_visits_counts[position->second];
+  switch (node.type) {
+    case Node::Type_XNode:
+      ++_x_nodes_step;
+      break;
+    case Node::Type_YNode:
+      ++_y_nodes_step;
+      break;
+    case Node::Type_TrapezoidNode:
+      break;
+  }
+}
+
+SearchProfile::Summary SearchProfile::summary() const {
+  Summary result;
+  result.queries_count = _x_nodes_steps.size();
+  result.x_nodes_steps = 0;
+  for (std::size_t steps : _x_nodes_steps) result.x_nodes_steps += steps;
+  result.y_nodes_steps = 0;
+  for (std::size_t steps : _y_nodes_steps) result.y_nodes_steps += steps;
+  result.max_depth =
+      _depths_histogram.empty() ? 0 : _depths_histogram.size() - 1;
+  result.average_depth =
+      result.queries_count == 0
+          ? 0.
+          : static_cast<double>(result.x_nodes_steps + result.y_nodes_steps) /
+                result.queries_count;
+  result.visited_nodes_count = static_cast<std::size_t>(
+      std::count_if(_visits_counts.begin(), _visits_counts.end(),
+                    [](std::size_t visits) { return visits > 0; }));
+  return result;
+}
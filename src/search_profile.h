@@ -0,0 +1,70 @@
+#ifndef SEARCH_PROFILE_H
+#define SEARCH_PROFILE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "node.h"
+
+/* Counters of instrumented point searches in the search graph rooted
+ * at the specified Node: numbers of XNode & YNode comparisons made by
+ * each query, histogram of queries depths (total numbers of comparisons)
+ * and number of visits of each node.
+ * Nodes are identified by their indices in Node::collect_nodes order,
+ * the same as in FrozenMap.
+ * Searches are made by Node::search overload which reports the passed
+ * nodes to the profile, so the ordinary one is not affected.
+ * Search graph is not owned and should outlive searches of the profile,
+ * counters stay valid after it is changed or destroyed. */
+class SearchProfile {
+ public:
+  struct Summary {
+    std::size_t queries_count;
+    std::size_t x_nodes_steps;  // Total over all queries.
+    std::size_t y_nodes_steps;  // Total over all queries.
+    std::size_t max_depth;
+    double average_depth;
+    std::size_t visited_nodes_count;  // Nodes visited at least once.
+  };
+
+  explicit SearchProfile(const Node& root);
+
+  /* Search count points specified by interleaved x & y coordinates,
+   * appending their counters to the ones of the previous searches. */
+  void search(const double* coordinates, std::size_t count);
+
+  // Count the node passed by the current search, called by Node::search.
+  void visit(const Node& node);
+
+  const std::vector<std::size_t>& x_nodes_steps() const {
+    return _x_nodes_steps;
+  }
+  const std::vector<std::size_t>& y_nodes_steps() const {
+    return _y_nodes_steps;
+  }
+  // Number of queries by their depth.
+  const std::vector<std::size_t>& depths_histogram() const {
+    return _depths_histogram;
+  }
+  // Number of visits by node index.
+  const std::vector<std::size_t>& visits_counts() const {
+    return _visits_counts;
+  }
+
+  Summary summary() const;
+
+ private:
+  const Node& _root;
+  // Index of each Node of the search graph.
+  std::unordered_map<const Node*, std::size_t> _indices;
+  // Counters of the current search.
+  std::size_t _x_nodes_step = 0;
+  std::size_t _y_nodes_step = 0;
+  std::vector<std::size_t> _x_nodes_steps;
+  std::vector<std::size_t> _y_nodes_steps;
+  std::vector<std::size_t> _depths_histogram;
+  std::vector<std::size_t> _visits_counts;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(std::size_t threads_count) {
+  if (threads_count == 0)
+    threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+  _threads.reserve(threads_count - 1);
+  for (std::size_t worker = 0; worker + 1 < threads_count; ++worker)
+    _threads.emplace_back(&ThreadPool::work, this, worker);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _job_started.notify_all();
+  for (std::thread& thread : _threads) thread.join();
+}
+
+void ThreadPool::run(const std::function<void(std::size_t)>& job) {
+  std::lock_guard<std::mutex> run_lock(_run_mutex);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _job = &job;
+    _error = nullptr;
+    _running = _threads.size();
+    ++_generation;
+  }
+  _job_started.notify_all();
+  execute(_threads.size());
+  std::unique_lock<std::mutex> lock(_mutex);
+  _job_finished.wait(lock, [this] { return _running == 0; });
+  _job = nullptr;
+  if (_error) std::rethrow_exception(_error);
+}
+
+void ThreadPool::work(std::size_t worker) {
+  std::size_t generation = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _job_started.wait(lock, [this, generation] {
+        return _stopping || _generation != generation;
+      });
+      if (_stopping) return;
+      generation = _generation;
+    }
+    execute(worker);
+    bool finished;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      finished = --_running == 0;
+    }
+    if (finished) _job_finished.notify_one();
+  }
+}
+
+void ThreadPool::execute(std::size_t worker) {
+  try {
+    (*_job)(worker);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_error) _error = std::current_exception();
+  }
+}
@@ -0,0 +1,100 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of worker threads running jobs on behalf of the caller.
+ * The calling thread takes part in each job as the last worker,
+ * so the pool with threads_count of 1 has no threads of its own.
+ * Jobs are run one at a time: concurrent calls of run are serialized. */
+class ThreadPool {
+ public:
+  /* Pool with the specified number of workers,
+   * zero stands for the number of hardware threads. */
+  explicit ThreadPool(std::size_t threads_count = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t threads_count() const { return _threads.size() + 1; }
+
+  /* Run job with each worker index from 0 to threads_count - 1
+   * and wait for all of them to finish,
+   * first exception thrown by the job is rethrown to the caller. */
+  void run(const std::function<void(std::size_t)>& job);
+
+  /* Call function(begin, end) for consecutive ranges of at most chunk_size
+   * indices covering [0, count).
+   * Each worker starts with its own contiguous share of chunks
+   * and once it is exhausted steals the remaining chunks of other workers,
+   * so workers which got cheaper chunks do not stay idle. */
+  template <class Function>
+  void for_each_chunk(std::size_t count, std::size_t chunk_size,
+                      Function function);
+
+ private:
+  // Chunks of a worker's share which are not taken yet,
+  // padded to avoid false sharing between workers.
+  struct Share {
+    std::atomic<std::size_t> next;
+    std::size_t end;
+    char padding[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+  };
+
+  std::vector<std::thread> _threads;
+  std::mutex _run_mutex;
+  std::mutex _mutex;
+  std::condition_variable _job_started, _job_finished;
+  const std::function<void(std::size_t)>* _job = nullptr;
+  std::size_t _generation = 0;
+  std::size_t _running = 0;
+  bool _stopping = false;
+  std::exception_ptr _error;
+
+  void work(std::size_t worker);
+  void execute(std::size_t worker);
+};
+
+template <class Function>
+void ThreadPool::for_each_chunk(std::size_t count, std::size_t chunk_size,
+                                Function function) {
+  if (chunk_size == 0) chunk_size = 1;
+  const std::size_t chunks_count =
+      count / chunk_size + (count % chunk_size != 0);
+  const std::size_t workers_count = std::min(threads_count(), chunks_count);
+  if (workers_count <= 1) {
+    if (count) function(std::size_t(0), count);
+    return;
+  }
+  std::unique_ptr<Share[]> shares(new Share[workers_count]);
+  for (std::size_t worker = 0; worker < workers_count; ++worker) {
+    shares[worker].next.store(chunks_count * worker / workers_count,
+                              std::memory_order_relaxed);
+    shares[worker].end = chunks_count * (worker + 1) / workers_count;
+  }
+  run([&](std::size_t worker) {
+    if (worker >= workers_count) return;
+    for (std::size_t offset = 0; offset < workers_count; ++offset) {
+      Share& share = shares[(worker + offset) % workers_count];
+      for (;;) {
+        const std::size_t chunk =
+            share.next.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= share.end) break;
+        const std::size_t begin = chunk * chunk_size;
+        function(begin, std::min(begin + chunk_size, count));
+      }
+    }
+  });
+}
+
+#endif
@@ -51,7 +51,7 @@ struct Trapezoid {
   Trapezoid* upper_left;   // Trapezoid to left  that shares above
   Trapezoid* upper_right;  // Trapezoid to right that shares above
 
-  Node* trapezoid_node;  // Node that owns this Trapezoid.
+  Node* trapezoid_node;  // Node that refers to this Trapezoid.
 };
 
 #endif
\ No newline at end of file
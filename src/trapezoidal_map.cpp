@@ -2,39 +2,504 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <random>
 #include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "bounding_box.h"
+#include "byte_buffer.h"
+#include "predicates.h"
+#include "thread_pool.h"
 
-/* Linear congruential random number generator.
+/* Random number generator for shuffling of edges.
  * Edges in the triangulation are randomly shuffled
  * before being added to the trapezoid map.
  * Want the shuffling to be identical across different operating systems
- * and the same regardless of previous random number use.
- * Would prefer to use a STL or Boost random number generator,
- * but support is not consistent across different operating systems
- * so implementing own here.
- *
- * This is not particularly random, but is perfectly adequate for the use here.
- * Coefficients taken from Numerical Recipes in C. */
+ * and the same regardless of previous random number use,
+ * so the standard 64-bit Mersenne Twister (whose sequence is fully
+ * specified by the standard) is used with own unbiased reduction to ranges
+ * instead of distributions (which are implementation-defined). */
 class RandomNumberGenerator {
  public:
-  RandomNumberGenerator(unsigned long seed)
-      : _m(21870), _a(1291), _c(4621), _seed(seed % _m) {}
+  explicit RandomNumberGenerator(std::uint64_t seed) : _engine(seed) {}
 
   // Return random integer in the range 0 to max_value-1.
-  unsigned long operator()(unsigned long max_value) {
-    _seed = (_seed * _a + _c) % _m;
-    return (_seed * max_value) / _m;
+  std::uint64_t operator()(std::uint64_t max_value) {
+    // Values from the incomplete last range are rejected.
+    const std::uint64_t limit =
+        std::numeric_limits<std::uint64_t>::max() -
+        std::numeric_limits<std::uint64_t>::max() % max_value;
+    std::uint64_t value;
+    do
+      value = _engine();
+    while (value >= limit);
+    return value % max_value;
   }
 
  private:
-  const unsigned long _m, _a, _c;
-  unsigned long _seed;
+  std::mt19937_64 _engine;
 };
 
-TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, bool shuffle)
-    : _points(points), _root(nullptr) {
+// Ring is counterclockwise if it turns left at its leftmost point.
+static bool is_ring_counterclockwise(const Point* points, std::size_t size) {
+  std::size_t leftmost = 0;
+  for (std::size_t index = 1; index < size; ++index)
+    if (points[leftmost].is_right_of(points[index])) leftmost = index;
+  const Point& previous = points[leftmost == 0 ? size - 1 : leftmost - 1];
+  const Point& next = points[leftmost + 1 == size ? 0 : leftmost + 1];
+  return orientation(next, points[leftmost], previous) > 0;
+}
+
+/* Saved maps start with the magic, the version of the format, flags
+ * (none are defined yet), the seed & order of insertion of edges
+ * for rebuilding and counts of records in the following sections. */
+static const char MAP_MAGIC[8] = {'S', 'E', 'I', 'D', 'E', 'L', 'T', 'M'};
+static const std::uint32_t MAP_FORMAT_VERSION = 2;
+// Index of the absent neighbour trapezoid.
+static const std::uint32_t MAP_NO_INDEX = 0xFFFFFFFF;
+// Sizes of records of points, edges, trapezoids & nodes.
+static const std::size_t MAP_POINT_SIZE = 16;
+static const std::size_t MAP_EDGE_SIZE = 8;
+static const std::size_t MAP_TRAPEZOID_SIZE = 32;
+static const std::size_t MAP_NODE_SIZE = 14;
+
+typedef TrapezoidalMap::BuildProfile::Stage BuildStage;
+
+// Stage of the profile or null if the map is not profiled.
+static BuildStage* get_stage(TrapezoidalMap::BuildProfile* profile,
+                             BuildStage TrapezoidalMap::BuildProfile::*stage) {
+  return profile == nullptr ? nullptr : &(profile->*stage);
+}
+
+static void add_stage(BuildStage& target, const BuildStage& source) {
+  target.calls += source.calls;
+  target.seconds += source.seconds;
+}
+
+// Call of the stage lasting for the scope of the timer,
+// does nothing for a null stage.
+class StageTimer {
+ public:
+  explicit StageTimer(BuildStage* stage) : _stage(stage) {
+    if (_stage != nullptr) _start = std::chrono::steady_clock::now();
+  }
+
+  ~StageTimer() {
+    if (_stage == nullptr) return;
+    ++_stage->calls;
+    _stage->seconds += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - _start)
+                           .count();
+  }
+
+  StageTimer(const StageTimer& other) = delete;
+  StageTimer& operator=(const StageTimer& other) = delete;
+
+ private:
+  BuildStage* _stage;
+  std::chrono::steady_clock::time_point _start;
+};
+
+const std::uint64_t TrapezoidalMap::DEFAULT_SEED;
+
+// Order of insertion of edges by constructors with shuffle flag.
+static TrapezoidalMap::Order to_order(bool shuffle) {
+  return shuffle ? TrapezoidalMap::Order_Shuffle
+                 : TrapezoidalMap::Order_Input;
+}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, bool shuffle,
+                               bool profile, std::uint64_t seed)
+    : TrapezoidalMap(points, to_order(shuffle), profile, seed) {}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, Order order,
+                               bool profile, std::uint64_t seed)
+    : _points(points),
+      _seed(seed),
+      _build_profile(profile ? new BuildProfile : nullptr),
+      _root(nullptr) {
+  if (!_points.empty()) _rings_offsets.push_back(0);
+  initialize(order);
+}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points,
+                               const std::vector<std::size_t>& rings_offsets,
+                               bool shuffle, bool profile,
+                               std::uint64_t seed)
+    : TrapezoidalMap(points, rings_offsets, to_order(shuffle), profile,
+                     seed) {}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points,
+                               const std::vector<std::size_t>& rings_offsets,
+                               Order order, bool profile, std::uint64_t seed)
+    : _points(points),
+      _rings_offsets(rings_offsets),
+      _seed(seed),
+      _build_profile(profile ? new BuildProfile : nullptr),
+      _root(nullptr) {
+  validate_rings_offsets();
+  initialize(order);
+}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points,
+                               const std::vector<Segment>& segments,
+                               const std::vector<Faces>& faces, bool shuffle,
+                               bool profile, std::uint64_t seed)
+    : _points(points),
+      _seed(seed),
+      _faces(faces),
+      _build_profile(profile ? new BuildProfile : nullptr),
+      _root(nullptr) {
+  if (!_faces.empty() && _faces.size() != segments.size())
+    throw std::invalid_argument(
+        "Faces should be specified either for all segments or for none.");
+  initialize_segments(segments);
+  _root = create_root();
+  insert_edges(inner_edges(), to_order(shuffle));
+}
+
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, bool shuffle,
+                               std::pmr::memory_resource* upstream)
+    : TrapezoidalMap(points, to_order(shuffle), upstream) {}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, Order order,
+                               std::pmr::memory_resource* upstream)
+    : _points(points), _arena(upstream), _root(nullptr) {
+  if (!_points.empty()) _rings_offsets.push_back(0);
+  initialize(order);
+}
+#endif
+
+/* Whether the first edge is below the second one, which do not cross
+ * and overlap in x-coordinates (besides at a shared endpoint),
+ * compared at the endpoint which is within both of them. */
+static bool is_edge_below(const Edge& first, const Edge& second) {
+  if (first.left == second.left)
+    return second.get_point_orientation(*first.right) > 0;
+  if (second.left->is_right_of(*first.left))
+    return first.get_point_orientation(*second.left) < 0;
+  return second.get_point_orientation(*first.left) > 0;
+}
+
+/* Return trapezoids of the slab map with the specified root
+ * along its right boundary if right is set and the left one otherwise
+ * from the bottom edge of the enclosing rectangle to the top one.
+ * Each of them is searched just above the edge below it at the boundary,
+ * where edges of the slab map are ordered as by is_edge_below. */
+static std::vector<Trapezoid*> collect_along_boundary(const Node& root,
+                                                      const Edge& bottom,
+                                                      const Edge& top,
+                                                      bool right) {
+  std::vector<Trapezoid*> result;
+  for (const Edge* edge = &bottom; edge != &top;) {
+    const Node* node = &root;
+    while (node->type != Node::Type_TrapezoidNode)
+      if (node->type == Node::Type_XNode)
+        // Points of the slab map are within its boundaries.
+        node = right ? node->data.xnode.right : node->data.xnode.left;
+      else {
+        const Edge& node_edge = *node->data.ynode.edge;
+        node = &node_edge != edge && is_edge_below(*edge, node_edge)
+                   ? node->data.ynode.below
+                   : node->data.ynode.above;
+      }
+    Trapezoid* trapezoid = node->data.trapezoid;
+    assert(&trapezoid->below == edge && "Trapezoid should be above edge");
+    result.push_back(trapezoid);
+    edge = &trapezoid->above;
+  }
+  return result;
+}
+
+TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, bool shuffle,
+                               ThreadPool& pool, std::size_t slabs_count,
+                               bool profile, std::uint64_t seed)
+    : _points(points),
+      _seed(seed),
+      _build_profile(profile ? new BuildProfile : nullptr),
+      _root(nullptr) {
+  if (!_points.empty()) _rings_offsets.push_back(0);
+  initialize_edges();
+  if (slabs_count == 0) slabs_count = pool.threads_count();
+
+  // Slabs boundaries are points splitting contour points
+  // into groups of roughly the same size in the order of points,
+  // so a boundary is a vertical line sheared by the order of points
+  // with equal x-coordinates and slabs are closed,
+  // i.e. points on a boundary belong to both of its slabs.
+  std::size_t npoints = _points.size() - 4;
+  std::vector<const Point*> sorted_points;
+  sorted_points.reserve(npoints);
+  for (std::size_t index = 0; index < npoints; ++index)
+    sorted_points.push_back(&_points[index]);
+  auto is_point_left_of = [](const Point* first, const Point* second) {
+    return second->is_right_of(*first);
+  };
+  std::sort(sorted_points.begin(), sorted_points.end(), is_point_left_of);
+  std::vector<const Point*> boundaries;
+  for (std::size_t slab = 1; slab < slabs_count && npoints > 0; ++slab) {
+    const Point* boundary = sorted_points[npoints * slab / slabs_count];
+    if (!boundaries.empty() && boundaries.back() == boundary) continue;
+    boundaries.push_back(boundary);
+  }
+  _order = to_order(shuffle);
+  if (boundaries.empty()) {
+    _root = create_root();
+    insert_edges(inner_edges(), _order);
+    return;
+  }
+
+  // Each slab gets edges which intersect it besides at the boundary point,
+  // so edges crossing boundaries are inserted in all of the slabs
+  // they cross and are clipped by their boundaries.
+  std::vector<std::vector<const Edge*>> slabs_edges(boundaries.size() + 1);
+  for (const Edge* edge : inner_edges()) {
+    std::size_t first =
+        std::upper_bound(boundaries.begin(), boundaries.end(), edge->left,
+                         is_point_left_of) -
+        boundaries.begin();
+    std::size_t last =
+        std::lower_bound(boundaries.begin(), boundaries.end(), edge->right,
+                         is_point_left_of) -
+        boundaries.begin();
+    for (std::size_t slab = first; slab <= last; ++slab)
+      slabs_edges[slab].push_back(edge);
+  }
+  _slabs.resize(slabs_edges.size());
+  // Trapezoids of slabs maps along their left & right boundaries.
+  std::vector<std::vector<Trapezoid*>> slabs_lefts(_slabs.size());
+  std::vector<std::vector<Trapezoid*>> slabs_rights(_slabs.size());
+  pool.for_each_chunk(
+      slabs_edges.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t slab = begin; slab < end; ++slab) {
+          _slabs[slab].reset(new TrapezoidalMap(
+              *this, slabs_edges[slab], _order,
+              slab > 0 ? boundaries[slab - 1] : nullptr,
+              slab < boundaries.size() ? boundaries[slab] : nullptr));
+          const Node& root = *_slabs[slab]->_root;
+          if (slab > 0)
+            slabs_lefts[slab] =
+                collect_along_boundary(root, _edges[0], _edges[1], false);
+          if (slab < boundaries.size())
+            slabs_rights[slab] =
+                collect_along_boundary(root, _edges[0], _edges[1], true);
+        }
+      });
+
+  // Slabs are routed by a balanced tree of XNodes
+  // for their boundaries, built bottom-up.
+  std::vector<Node*> nodes;
+  nodes.reserve(_slabs.size());
+  for (const auto& slab : _slabs) nodes.push_back(slab->_root);
+  std::vector<const Point*> nodes_boundaries(boundaries);
+  while (nodes.size() > 1) {
+    std::vector<Node*> parents;
+    std::vector<const Point*> parents_boundaries;
+    for (std::size_t index = 0; index < nodes_boundaries.size(); index += 2) {
+      parents.push_back(_arena.create<Node>(nodes_boundaries[index],
+                                            nodes[index], nodes[index + 1]));
+      if (index + 1 < nodes_boundaries.size())
+        parents_boundaries.push_back(nodes_boundaries[index + 1]);
+    }
+    if (nodes.size() % 2) parents.push_back(nodes.back());
+    nodes.swap(parents);
+    nodes_boundaries.swap(parents_boundaries);
+  }
+  _root = nodes.front();
+  stitch_slabs(slabs_lefts, slabs_rights);
+  _root->assert_valid();
+}
+
+TrapezoidalMap::TrapezoidalMap() : _root(nullptr) {}
+
+TrapezoidalMap::TrapezoidalMap(const TrapezoidalMap& map,
+                               const std::vector<const Edge*>& edges,
+                               Order order, const Point* slab_left,
+                               const Point* slab_right)
+    : _seed(map._seed),
+      _build_profile(map.is_profiled() ? new BuildProfile : nullptr),
+      _slab_left(slab_left),
+      _slab_right(slab_right),
+      _root(nullptr) {
+  _root = create_root(map);
+  insert_edges(edges, order);
+}
+
+void TrapezoidalMap::stitch_slabs(
+    const std::vector<std::vector<Trapezoid*>>& slabs_lefts,
+    const std::vector<std::vector<Trapezoid*>>& slabs_rights) {
+  // Trapezoids of slabs merged into the ones to the left of them.
+  std::unordered_map<const Trapezoid*, Trapezoid*> merged;
+  for (std::size_t slab = 1; slab < _slabs.size(); ++slab) {
+    // Trapezoids along a boundary are separated by distinct edges
+    // crossing it or ending at its point.
+    std::unordered_map<const Edge*, Trapezoid*> rights_by_below;
+    std::unordered_map<const Edge*, Trapezoid*> rights_by_above;
+    for (Trapezoid* trapezoid : slabs_lefts[slab]) {
+      rights_by_below.emplace(&trapezoid->below, trapezoid);
+      rights_by_above.emplace(&trapezoid->above, trapezoid);
+    }
+    for (Trapezoid* trapezoid : slabs_rights[slab - 1]) {
+      auto position = merged.find(trapezoid);
+      if (position != merged.end()) trapezoid = position->second;
+      assert(trapezoid->right == _slabs[slab]->_slab_left &&
+             "Trapezoid should be along the boundary");
+      auto below = rights_by_below.find(&trapezoid->below);
+      auto above = rights_by_above.find(&trapezoid->above);
+      Trapezoid* lower_right =
+          below == rights_by_below.end() ? nullptr : below->second;
+      Trapezoid* upper_right =
+          above == rights_by_above.end() ? nullptr : above->second;
+      if (lower_right == nullptr || lower_right != upper_right) {
+        // Trapezoids are separated by the wall of the boundary point.
+        if (lower_right != nullptr) trapezoid->set_lower_right(lower_right);
+        if (upper_right != nullptr) trapezoid->set_upper_right(upper_right);
+        continue;
+      }
+      // Trapezoids are separated by the boundary only.
+      Trapezoid* right = lower_right;
+      trapezoid->right = right->right;
+      trapezoid->set_lower_right(right->lower_right);
+      trapezoid->set_upper_right(right->upper_right);
+      replace_node(right->trapezoid_node, trapezoid->trapezoid_node);
+      merged.emplace(right, trapezoid);
+      _slabs[slab]->_arena.destroy(right->trapezoid_node);
+      _slabs[slab]->_arena.destroy(right);
+    }
+  }
+  // Roots of slabs maps are parts of the search graph of this map now.
+  for (const auto& slab : _slabs) slab->_root = nullptr;
+}
+
+std::unique_ptr<TrapezoidalMap> TrapezoidalMap::build_shallowest(
+    const std::vector<Point>& points,
+    const std::vector<std::size_t>& rings_offsets,
+    std::size_t candidates_count, std::uint64_t seed, double depth_factor,
+    ThreadPool* pool) {
+  if (candidates_count == 0)
+    throw std::invalid_argument("Candidates count should be positive.");
+  const double max_depth =
+      depth_factor *
+      std::log2(static_cast<double>(std::max<std::size_t>(points.size(), 2)));
+  const std::size_t round_size =
+      pool == nullptr ? 1 : std::min(pool->threads_count(), candidates_count);
+  std::unique_ptr<TrapezoidalMap> result;
+  std::size_t result_depth = 0;
+  std::vector<std::unique_ptr<TrapezoidalMap>> candidates(round_size);
+  for (std::size_t offset = 0; offset < candidates_count;
+       offset += round_size) {
+    std::size_t count = std::min(round_size, candidates_count - offset);
+    auto build = [&](std::size_t begin, std::size_t end) {
+      for (std::size_t index = begin; index < end; ++index)
+        candidates[index].reset(new TrapezoidalMap(
+            points, rings_offsets, true, false, seed + offset + index));
+    };
+    if (pool == nullptr)
+      build(0, count);
+    else
+      pool->for_each_chunk(count, 1, build);
+    for (std::size_t index = 0; index < count; ++index) {
+      std::size_t depth = candidates[index]->stats().max_leaf_depth;
+      if (!result || depth < result_depth) {
+        result = std::move(candidates[index]);
+        result_depth = depth;
+      }
+      candidates[index].reset();
+    }
+    if (depth_factor > 0. && result_depth <= max_depth) break;
+  }
+  return result;
+}
+
+std::unique_ptr<TrapezoidalMap> TrapezoidalMap::build_phased(
+    const std::vector<Point>& points,
+    const std::vector<std::size_t>& rings_offsets, std::uint64_t seed,
+    bool profile) {
+  std::unique_ptr<TrapezoidalMap> result(new TrapezoidalMap());
+  result->_points = points;
+  result->_rings_offsets = rings_offsets;
+  result->_seed = seed;
+  if (profile) result->_build_profile.reset(new BuildProfile);
+  result->validate_rings_offsets();
+  result->initialize_edges();
+  result->_root = result->create_root();
+  result->insert_edges_phased();
+  return result;
+}
+
+void TrapezoidalMap::validate_rings_offsets() const {
+  bool valid = _rings_offsets.empty() ? _points.empty()
+                                      : _rings_offsets.front() == 0;
+  for (std::size_t ring = 1; valid && ring < _rings_offsets.size(); ++ring)
+    valid = _rings_offsets[ring - 1] < _rings_offsets[ring];
+  if (!valid || (!_rings_offsets.empty() &&
+                 _rings_offsets.back() >= _points.size()))
+    throw std::invalid_argument(
+        "Rings offsets should start with 0 "
+        "and strictly increase within points.");
+}
+
+void TrapezoidalMap::initialize(Order order) {
+  initialize_edges();
+  _root = create_root();
+  insert_edges(inner_edges(), order);
+}
+
+void TrapezoidalMap::initialize_edges() {
+  std::size_t npoints = _points.size();
+  initialize_enclosing_rectangle();
+
+  // Each ring is closed by the edge from its last point to its first one.
+  for (std::size_t ring = 0; ring < _rings_offsets.size(); ++ring) {
+    std::size_t begin = _rings_offsets[ring];
+    std::size_t end = ring + 1 < _rings_offsets.size()
+                          ? _rings_offsets[ring + 1]
+                          : npoints;
+    bool counterclockwise =
+        is_ring_counterclockwise(&_points[begin], end - begin);
+    for (std::size_t index = begin; index < end; ++index) {
+      Point* start = &_points[index];
+      Point* finish = &_points[index + 1 == end ? begin : index + 1];
+      // Interior of the counterclockwise ring is to the left of its edges.
+      bool forward = finish->is_right_of(*start);
+      if (forward)
+        _edges.push_back(Edge(start, finish));
+      else
+        _edges.push_back(Edge(finish, start));
+      _interiors_below.push_back(forward != counterclockwise);
+    }
+  }
+}
+
+void TrapezoidalMap::initialize_segments(
+    const std::vector<Segment>& segments) {
+  std::size_t npoints = _points.size();
+  initialize_enclosing_rectangle();
+  for (const Segment& segment : segments) {
+    if (segment.first >= npoints || segment.second >= npoints ||
+        segment.first == segment.second)
+      throw std::invalid_argument(
+          "Segments should connect distinct points by their indices.");
+    Point* start = &_points[segment.first];
+    Point* end = &_points[segment.second];
+    if (end->is_right_of(*start))
+      _edges.push_back(Edge(start, end));
+    else
+      _edges.push_back(Edge(end, start));
+    // Segments do not bound rings.
+    _interiors_below.push_back(false);
+  }
+}
+
+void TrapezoidalMap::initialize_enclosing_rectangle() {
   // Set up points array, which contains all of the points in the
   // triangulation plus the 4 corners of the enclosing rectangle.
   BoundingBox bbox;
@@ -56,7 +521,7 @@ TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, bool shuffle)
     bbox.expand((bbox.upper - bbox.lower) * small);
   }
 
-  std::size_t npoints = points.size();
+  std::size_t npoints = _points.size();
 
   _points.push_back(Point(bbox.lower));                  // SW point.
   _points.push_back(Point(bbox.upper.x, bbox.lower.y));  // SE point.
@@ -68,43 +533,1151 @@ TrapezoidalMap::TrapezoidalMap(const std::vector<Point>& points, bool shuffle)
   _edges.push_back(Edge(&_points[npoints], &_points[npoints + 1]));
   _edges.push_back(Edge(&_points[npoints + 2], &_points[npoints + 3]));
 
-  for (std::size_t index = 0; index < npoints; ++index) {
-    Point* start = &_points[index];
-    Point* end = &_points[(index + 1) % npoints];
-    if (end->is_right_of(*start))
-      _edges.push_back(Edge(start, end));
-    else
-      _edges.push_back(Edge(end, start));
-  }
+  // Interior of the enclosing rectangle is above its bottom edge
+  // and below its top edge.
+  _interiors_below.push_back(false);
+  _interiors_below.push_back(true);
+}
 
-  // Initial trapezoid is enclosing rectangle.
-  _root = new Node(new Trapezoid(&_points[npoints], &_points[npoints + 1],
-                                 _edges[0], _edges[1]));
-  _root->assert_valid();
+Node* TrapezoidalMap::create_root() { return create_root(*this); }
+
+Node* TrapezoidalMap::create_root(const TrapezoidalMap& map) {
+  // Initial trapezoid is enclosing rectangle clipped to the slab.
+  std::size_t npoints = map._points.size() - 4;
+  Node* result = _arena.create<Node>(_arena.create<Trapezoid>(
+      _slab_left != nullptr ? _slab_left : &map._points[npoints],
+      _slab_right != nullptr ? _slab_right : &map._points[npoints + 1],
+      map._edges[0], map._edges[1]));
+  result->assert_valid();
+  return result;
+}
+
+std::vector<const Edge*> TrapezoidalMap::inner_edges() const {
+  std::vector<const Edge*> result;
+  result.reserve(_edges.size() - 2);
+  for (std::size_t index = 2; index < _edges.size(); ++index)
+    result.push_back(&_edges[index]);
+  return result;
+}
 
-  // Randomly shuffle all edges other than first 2.
-  if (shuffle) {
-    RandomNumberGenerator rng(1234);
-    std::random_shuffle(_edges.begin() + 2, _edges.end(), rng);
+void TrapezoidalMap::insert_edges(std::vector<const Edge*> edges,
+                                  Order order) {
+  // Randomly shuffle edges.
+  if (order != Order_Input) {
+    RandomNumberGenerator rng(_seed);
+    for (std::size_t index = edges.size(); index > 1; --index)
+      std::swap(edges[index - 1], edges[rng(index)]);
   }
+  _order = order;
+  if (order == Order_Brio) sort_brio_rounds(edges);
   // Add edges, one at a time, to graph.
-  std::size_t nedges = _edges.size();
-  for (std::size_t index = 2; index < nedges; ++index) {
-    if (!add_edge(_edges[index]))
-      throw std::runtime_error("Triangulation is invalid");
+  for (const Edge* edge : edges) {
+    if (!add_edge(*edge)) throw std::runtime_error("Triangulation is invalid");
     _root->assert_valid();
   }
 }
 
-TrapezoidalMap::~TrapezoidalMap() { delete _root; }
+// Number of cells along each side of the grid of the Hilbert curve.
+static const std::uint64_t HILBERT_GRID_SIZE = std::uint64_t(1) << 31;
+
+// Index of the cell with the specified coordinates along the Hilbert curve.
+static std::uint64_t to_hilbert_index(std::uint64_t x, std::uint64_t y) {
+  std::uint64_t result = 0;
+  for (std::uint64_t size = HILBERT_GRID_SIZE / 2; size > 0; size /= 2) {
+    std::uint64_t rx = (x & size) > 0, ry = (y & size) > 0;
+    result += size * size * ((3 * rx) ^ ry);
+    // Rotate the quadrant, so the curve in it has the canonical orientation.
+    if (ry == 0) {
+      if (rx == 1) {
+        x = HILBERT_GRID_SIZE - 1 - x;
+        y = HILBERT_GRID_SIZE - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return result;
+}
+
+// Cell of the coordinate in the grid of the Hilbert curve over the range.
+static std::uint64_t to_hilbert_cell(double value, double min_value,
+                                     double max_value) {
+  if (!(max_value > min_value)) return 0;
+  double cell = (value - min_value) / (max_value - min_value) *
+                static_cast<double>(HILBERT_GRID_SIZE - 1);
+  return static_cast<std::uint64_t>(std::max(cell, 0.));
+}
+
+void TrapezoidalMap::sort_brio_rounds(std::vector<const Edge*>& edges) {
+  BoundingBox box;
+  for (const Edge* edge : edges) {
+    box.add(*edge->left);
+    box.add(*edge->right);
+  }
+  std::vector<std::pair<std::uint64_t, const Edge*>> keyed_edges;
+  keyed_edges.reserve(edges.size());
+  for (const Edge* edge : edges) {
+    double x = (edge->left->x + edge->right->x) / 2.;
+    double y = (edge->left->y + edge->right->y) / 2.;
+    keyed_edges.emplace_back(
+        to_hilbert_index(to_hilbert_cell(x, box.lower.x, box.upper.x),
+                         to_hilbert_cell(y, box.lower.y, box.upper.y)),
+        edge);
+  }
+  /* Shuffled edges are split into rounds of halving sizes from the end,
+   * stable sort keeps the order of edges with the same index
+   * the same on all platforms. */
+  for (std::size_t end = keyed_edges.size(); end > 0;) {
+    std::size_t begin = end / 2;
+    std::stable_sort(
+        keyed_edges.begin() + begin, keyed_edges.begin() + end,
+        [](const std::pair<std::uint64_t, const Edge*>& first,
+           const std::pair<std::uint64_t, const Edge*>& second) {
+          return first.first < second.first;
+        });
+    end = begin;
+  }
+  for (std::size_t index = 0; index < edges.size(); ++index)
+    edges[index] = keyed_edges[index].second;
+}
+
+/* Numbers of edges inserted by the end of each phase of the phased
+ * construction of the specified number of edges: N / log^(h) N
+ * for the h-times iterated logarithm while it exceeds 1, then all. */
+static std::vector<std::size_t> get_phases_ends(std::size_t count) {
+  std::vector<std::size_t> result;
+  double logarithm = static_cast<double>(count);
+  for (;;) {
+    logarithm = std::log2(logarithm);
+    if (!(logarithm > 1.)) break;
+    std::size_t end = static_cast<std::size_t>(count / logarithm);
+    if (result.empty() || end > result.back()) result.push_back(end);
+  }
+  if (result.empty() || result.back() < count) result.push_back(count);
+  return result;
+}
 
-bool TrapezoidalMap::add_edge(const Edge& edge) {
+/* Walk along the edge of the map from the trapezoid containing the start
+ * of its part traversed from the left endpoint to the right one if forward
+ * and backwards otherwise, to the trapezoid containing the end of it.
+ * Inserted edges are walked on the left side of traversal, i.e. along
+ * trapezoids above them if forward and below them otherwise.
+ * Return null if fails. */
+static const Trapezoid* walk_edge(const Trapezoid* trapezoid, const Edge& edge,
+                                  bool forward, bool inserted) {
+  if (forward) {
+    if (inserted && &trapezoid->below != &edge) return nullptr;
+    while (edge.right->is_right_of(*trapezoid->right)) {
+      int orient =
+          inserted ? -1 : edge.get_point_orientation(*trapezoid->right);
+      if (orient == 0) return nullptr;
+      trapezoid = orient < 0 ? trapezoid->lower_right : trapezoid->upper_right;
+      if (trapezoid == nullptr) return nullptr;
+    }
+  } else {
+    if (inserted && &trapezoid->above != &edge) return nullptr;
+    while (trapezoid->left->is_right_of(*edge.left)) {
+      int orient = inserted ? 1 : edge.get_point_orientation(*trapezoid->left);
+      if (orient == 0) return nullptr;
+      trapezoid = orient < 0 ? trapezoid->lower_left : trapezoid->upper_left;
+      if (trapezoid == nullptr) return nullptr;
+    }
+  }
+  return trapezoid;
+}
+
+/* Turn around the vertex which is an endpoint of an inserted edge
+ * from the trapezoid containing points of the edge from the previous point
+ * near the vertex (on the left side of traversal) to the trapezoid
+ * containing points of the edge to the next point near it.
+ * Turning sweeps clockwise on the left side of traversal,
+ * crossing the parts of the vertical wall of the vertex above and/or
+ * below it, which separate trapezoids with the vertex as the right point
+ * from the ones with it as the left point.
+ * Return null if fails. */
+static const Trapezoid* turn_at(const Trapezoid* trapezoid, const Point& vertex,
+                                const Point& previous, const Point& next) {
+  bool from_right = previous.is_right_of(vertex);
+  bool to_right = next.is_right_of(vertex);
+  bool crosses_both = false;
+  if (from_right == to_right) {
+    int orient = orientation(previous, vertex, next);
+    if (orient == 0) return nullptr;
+    // Clockwise sweep stays on the same side of the wall.
+    if (orient < 0) return trapezoid;
+    crosses_both = true;
+  }
+  for (bool right = from_right;;) {
+    if (right) {
+      // Crossing the wall below the vertex to the left.
+      if (trapezoid->left != &vertex) return nullptr;
+      trapezoid = trapezoid->lower_left;
+    } else {
+      // Crossing the wall above the vertex to the right.
+      if (trapezoid->right != &vertex) return nullptr;
+      trapezoid = trapezoid->upper_right;
+    }
+    if (trapezoid == nullptr || !crosses_both) return trapezoid;
+    crosses_both = false;
+    right = !right;
+  }
+}
+
+void TrapezoidalMap::insert_edges_phased() {
+  // Same order of edges as of insert_edges with shuffle.
+  std::vector<std::size_t> order;
+  const std::size_t count = _edges.size() - 2;
+  order.reserve(count);
+  for (std::size_t index = 0; index < count; ++index) order.push_back(index);
+  RandomNumberGenerator rng(_seed);
+  for (std::size_t index = count; index > 1; --index)
+    std::swap(order[index - 1], order[rng(index)]);
+
+  // Edges are indexed by their starting points in rings.
+  std::vector<bool> inserted(count, false);
+  std::vector<const Node*> starts(count, nullptr);
+  _keep_replaced = true;
+  std::size_t begin = 0;
+  for (std::size_t end : get_phases_ends(count)) {
+    for (std::size_t index = begin; index < end; ++index) {
+      std::size_t edge = order[index];
+      if (!add_edge(_edges[edge + 2], starts[edge]))
+        throw std::runtime_error("Triangulation is invalid");
+      inserted[edge] = true;
+      _root->assert_valid();
+    }
+    begin = end;
+    if (end < count)
+      for (std::size_t ring = 0; ring < _rings_offsets.size(); ++ring) {
+        std::size_t ring_begin = _rings_offsets[ring];
+        std::size_t ring_end = ring + 1 < _rings_offsets.size()
+                                   ? _rings_offsets[ring + 1]
+                                   : count;
+        // Degenerate rings are searched from the root.
+        if (!trace_ring(ring_begin, ring_end, inserted, starts))
+          std::fill(starts.begin() + ring_begin, starts.begin() + ring_end,
+                    nullptr);
+      }
+  }
+  _keep_replaced = false;
+}
+
+bool TrapezoidalMap::trace_ring(std::size_t begin, std::size_t end,
+                                const std::vector<bool>& inserted,
+                                std::vector<const Node*>& starts) const {
+  const std::size_t size = end - begin;
+  std::size_t first = begin;
+  while (first < end && inserted[first]) ++first;
+  if (first == end) return true;
+  auto get_next = [&](std::size_t index) {
+    return index + 1 == end ? begin : index + 1;
+  };
+
+  // Walk starts from the left endpoint of the first edge to insert.
+  const Edge& first_edge = _edges[first + 2];
+  const Trapezoid* trapezoid = _root->search(first_edge);
+  if (trapezoid == nullptr) return false;
+  starts[first] = trapezoid->trapezoid_node;
+  if (first_edge.left == &_points[first]) {
+    trapezoid = walk_edge(trapezoid, first_edge, true, false);
+    if (trapezoid == nullptr) return false;
+  }
+  for (std::size_t step = 1; step < size; ++step) {
+    std::size_t index = begin + (first - begin + step) % size;
+    std::size_t previous = index == begin ? end - 1 : index - 1;
+    const Point& vertex = _points[index];
+    // There is a wall through the vertex only if it is an endpoint
+    // of an inserted edge.
+    if (inserted[previous] || inserted[index]) {
+      trapezoid = turn_at(trapezoid, vertex, _points[previous],
+                          _points[get_next(index)]);
+      if (trapezoid == nullptr) return false;
+    }
+    const Edge& edge = _edges[index + 2];
+    bool forward = edge.left == &vertex;
+    if (!inserted[index] && forward) starts[index] = trapezoid->trapezoid_node;
+    trapezoid = walk_edge(trapezoid, edge, forward, inserted[index]);
+    if (trapezoid == nullptr) return false;
+    if (!inserted[index] && !forward) starts[index] = trapezoid->trapezoid_node;
+  }
+  return true;
+}
+
+// Nodes and trapezoids hold no resources, so they are released at once
+// together with the arena.
+TrapezoidalMap::~TrapezoidalMap() {}
+
+const Locator& TrapezoidalMap::locator() const {
+  if (!_locator) _locator.reset(new Locator(*_root));
+  return *_locator;
+}
+
+TrapezoidalMap::Stats TrapezoidalMap::stats() const {
+  Stats result;
+  // Reversed post-order is topological, so all parents of a node
+  // are visited before it and its depth is final by then.
+  const std::vector<const Node*> nodes = _root->collect_nodes_bottom_up();
+  std::unordered_map<const Node*, std::size_t> indices;
+  indices.reserve(nodes.size());
+  for (std::size_t index = 0; index < nodes.size(); ++index)
+    indices.emplace(nodes[index], index);
+  std::vector<std::size_t> depths(nodes.size(), 0);
+  std::vector<std::size_t> parents_counts(nodes.size(), 0);
+  std::size_t leaves_depths = 0;
+  for (std::size_t index = nodes.size(); index-- > 0;) {
+    const Node& node = *nodes[index];
+    if (parents_counts[index] > 1) ++result.shared_nodes_count;
+    if (node.type == Node::Type_TrapezoidNode) {
+      ++result.leaves_count;
+      result.max_leaf_depth = std::max(result.max_leaf_depth, depths[index]);
+      leaves_depths += depths[index];
+      continue;
+    }
+    const Node* children[2];
+    if (node.type == Node::Type_XNode) {
+      ++result.x_nodes_count;
+      children[0] = node.data.xnode.left;
+      children[1] = node.data.xnode.right;
+    } else {
+      ++result.y_nodes_count;
+      children[0] = node.data.ynode.below;
+      children[1] = node.data.ynode.above;
+    }
+    for (const Node* child : children) {
+      std::size_t child_index = indices[child];
+      ++parents_counts[child_index];
+      depths[child_index] = std::max(depths[child_index], depths[index] + 1);
+    }
+    result.parents_links_count += 2;
+  }
+  if (result.leaves_count > 0)
+    result.average_leaf_depth =
+        static_cast<double>(leaves_depths) / result.leaves_count;
+  result.nodes_bytes = nodes.size() * sizeof(Node);
+  result.trapezoids_bytes = result.leaves_count * sizeof(Trapezoid);
+  result.points_bytes = _points.size() * sizeof(Point) +
+                        _inserted_points.size() * sizeof(InsertedPoint);
+  result.edges_bytes = _edges.size() * sizeof(Edge) +
+                       _inserted_edges.size() * sizeof(InsertedEdge);
+  return result;
+}
+
+TrapezoidalMap::BuildProfile TrapezoidalMap::build_profile() const {
+  if (!_build_profile) throw std::runtime_error("Map is not profiled.");
+  BuildProfile result = *_build_profile;
+  result.arena_bytes = _arena.allocated_bytes();
+  for (const auto& slab : _slabs) {
+    BuildProfile slab_result = slab->build_profile();
+    add_stage(result.search_edge, slab_result.search_edge);
+    add_stage(result.find_trapezoids, slab_result.find_trapezoids);
+    add_stage(result.allocate_trapezoids, slab_result.allocate_trapezoids);
+    add_stage(result.allocate_nodes, slab_result.allocate_nodes);
+    add_stage(result.replace_nodes, slab_result.replace_nodes);
+    result.crossed_trapezoids_counts.insert(
+        result.crossed_trapezoids_counts.end(),
+        slab_result.crossed_trapezoids_counts.begin(),
+        slab_result.crossed_trapezoids_counts.end());
+    result.arena_bytes += slab_result.arena_bytes;
+  }
+  result.trapezoids_bytes =
+      result.allocate_trapezoids.calls * sizeof(Trapezoid);
+  result.nodes_bytes = result.allocate_nodes.calls * sizeof(Node);
+  return result;
+}
+
+template <class... Args>
+Trapezoid* TrapezoidalMap::create_trapezoid(Args&&... args) {
+  StageTimer timer(get_stage(_build_profile.get(),
+                             &BuildProfile::allocate_trapezoids));
+  return _arena.create<Trapezoid>(std::forward<Args>(args)...);
+}
+
+template <class... Args>
+Node* TrapezoidalMap::create_node(Args&&... args) {
+  StageTimer timer(
+      get_stage(_build_profile.get(), &BuildProfile::allocate_nodes));
+  return _arena.create<Node>(std::forward<Args>(args)...);
+}
+
+std::size_t TrapezoidalMap::insert_edge(const Point& start, const Point& end,
+                                        const Faces& faces) {
+  std::unique_lock<Mutex> lock(_mutex);
+  std::size_t points_count = _inserted_points.size();
+  try {
+    const Point* left = insert_point(start, -1);
+    const Point* right = insert_point(end, -1);
+    return insert_ring_edge(left, right, -1, false, faces);
+  } catch (...) {
+    while (_inserted_points.size() > points_count) _inserted_points.pop_back();
+    throw;
+  }
+}
+
+std::size_t TrapezoidalMap::insert_contour(const std::vector<Point>& contour) {
+  if (contour.size() < 3)
+    throw std::invalid_argument("Contour should have at least 3 points.");
+  std::unique_lock<Mutex> lock(_mutex);
+  std::int64_t ring = static_cast<std::int64_t>(rings_count());
+  bool counterclockwise =
+      is_ring_counterclockwise(contour.data(), contour.size());
+  // Points are resolved once before edges are inserted,
+  // so consecutive edges share their common point.
+  std::size_t points_count = _inserted_points.size();
+  std::vector<const Point*> points;
+  points.reserve(contour.size());
+  try {
+    for (const Point& point : contour)
+      points.push_back(insert_point(point, ring));
+    std::vector<const Point*> sorted_points(points);
+    std::sort(sorted_points.begin(), sorted_points.end(),
+              [](const Point* first, const Point* second) {
+                return second->is_right_of(*first);
+              });
+    for (std::size_t index = 1; index < sorted_points.size(); ++index)
+      if (*sorted_points[index - 1] == *sorted_points[index])
+        throw std::invalid_argument("Contour should not repeat points.");
+  } catch (...) {
+    while (_inserted_points.size() > points_count) _inserted_points.pop_back();
+    throw;
+  }
+  ++_inserted_rings_count;
+  std::size_t edges_count = _inserted_edges.size();
+  std::size_t faces_count = _faces.size();
+  for (std::size_t index = 0; index < points.size(); ++index) {
+    const Point* start = points[index];
+    const Point* finish = points[index + 1 == points.size() ? 0 : index + 1];
+    bool forward = finish->is_right_of(*start);
+    try {
+      insert_ring_edge(start, finish, ring, forward != counterclockwise,
+                       Faces(-1, -1));
+    } catch (...) {
+      // Preceding edges of the contour are in the search graph,
+      // which is rebuilt without them.
+      --_inserted_rings_count;
+      while (_inserted_edges.size() > edges_count) {
+        _inserted_edges.pop_back();
+        _interiors_below.pop_back();
+      }
+      _faces.resize(faces_count);
+      while (_inserted_points.size() > points_count)
+        _inserted_points.pop_back();
+      if (index > 0) {
+        rebuild();
+        ++_version;
+      }
+      throw;
+    }
+  }
+  return static_cast<std::size_t>(ring);
+}
+
+const Point* TrapezoidalMap::insert_point(const Point& point,
+                                          std::int64_t ring) {
+  Point xy(point);
+  // Avoid problems with -0. values different from 0.
+  if (xy.x == -0.) xy.x = 0.;
+  if (xy.y == -0.) xy.y = 0.;
+  const Point& lower = _points[_points.size() - 4];
+  const Point& upper = _points.back();
+  if (!(lower.x < xy.x && xy.x < upper.x && lower.y < xy.y && xy.y < upper.y))
+    throw std::invalid_argument(
+        "Points should lie inside of the enclosing rectangle of the map.");
+  const Node* node = _root->search(xy);
+  switch (node->type) {
+    case Node::Type_XNode:
+      if (*node->data.xnode.point == xy) return node->data.xnode.point;
+      break;
+    case Node::Type_YNode:
+      throw std::invalid_argument("Points should not lie on edges of the map.");
+    case Node::Type_TrapezoidNode:
+      break;
+  }
+  _inserted_points.emplace_back(
+      xy, _points.size() - 4 + _inserted_points.size(), ring);
+  return &_inserted_points.back();
+}
+
+std::size_t TrapezoidalMap::insert_ring_edge(const Point* start,
+                                             const Point* end,
+                                             std::int64_t ring,
+                                             bool interior_below,
+                                             const Faces& faces) {
+  if (*start == *end)
+    throw std::invalid_argument("Edge should connect distinct points.");
+  const Point* left = start;
+  const Point* right = end;
+  if (left->is_right_of(*right)) std::swap(left, right);
+  std::size_t index = _edges.size() + _inserted_edges.size();
+  _inserted_edges.emplace_back(left, right, index, ring);
+  _interiors_below.push_back(interior_below);
+  const Edge& edge = _inserted_edges.back();
+  // Trapezoids along the edge are found without changing the map,
+  // the first contact of the edge with the map's ones (if any)
+  // is on the boundary of one of them.
   std::vector<Trapezoid*> trapezoids;
-  if (!find_trapezoids_intersecting_edge(edge, trapezoids)) return false;
+  bool valid = find_trapezoids_intersecting_edge(edge, *_root, trapezoids);
+  for (std::size_t position = 0; valid && position < trapezoids.size();
+       ++position)
+    valid = !edge.intersects(trapezoids[position]->below) &&
+            !edge.intersects(trapezoids[position]->above);
+  if (!valid) {
+    _inserted_edges.pop_back();
+    _interiors_below.pop_back();
+    throw std::invalid_argument(
+        "Edge should not cross, overlap or touch edges of the map.");
+  }
+  // Edges of unlabelled map are labelled as outside of all faces
+  // once a labelled one is inserted.
+  if (!_faces.empty() || faces != Faces(-1, -1)) {
+    _faces.resize(index - 2, Faces(-1, -1));
+    _faces.push_back(faces);
+  }
+  add_edge(edge, trapezoids);
+  ++_version;
+  return index - 2;
+}
+
+void TrapezoidalMap::erase_edge(std::size_t segment) {
+  std::unique_lock<Mutex> lock(_mutex);
+  std::size_t edges_count = _edges.size() + _inserted_edges.size();
+  std::size_t index = segment + 2;
+  if (index >= edges_count ||
+      (index < _erased_edges.size() && _erased_edges[index]))
+    throw std::invalid_argument("Segment should be in the map.");
+  _erased_edges.resize(edges_count, false);
+  _erased_edges[index] = true;
+  ++_erased_edges_count;
+  remove_edge(get_edge(index));
+  ++_version;
+  // Erased nodes make the graph larger and deeper than it would be
+  // for the remaining edges.
+  if (_erased_nodes_count > edges_count - 2 - _erased_edges_count) rebuild();
+}
+
+const Edge& TrapezoidalMap::get_edge(std::size_t index) const {
+  if (index < _edges.size()) return _edges[index];
+  return _inserted_edges[index - _edges.size()];
+}
+
+void TrapezoidalMap::remove_edge(const Edge& edge) {
+  // Trapezoids along the edge from left to right.
+  std::vector<Trapezoid*> belows, aboves;
+  for (Trapezoid* trapezoid = _root->search_adjacent(edge, false);;
+       trapezoid = trapezoid->upper_right) {
+    assert(trapezoid != nullptr && &trapezoid->above == &edge &&
+           "Trapezoid should be below edge");
+    belows.push_back(trapezoid);
+    if (trapezoid->right == edge.right) break;
+  }
+  for (Trapezoid* trapezoid = _root->search_adjacent(edge, true);;
+       trapezoid = trapezoid->lower_right) {
+    assert(trapezoid != nullptr && &trapezoid->below == &edge &&
+           "Trapezoid should be above edge");
+    aboves.push_back(trapezoid);
+    if (trapezoid->right == edge.right) break;
+  }
+
+  // Endpoint of no other edge has a single trapezoid beside it,
+  // which is merged as well.
+  Trapezoid* left = belows.front()->lower_left;
+  if (left != nullptr &&
+      (left != aboves.front()->upper_left || left->right != edge.left))
+    left = nullptr;
+  Trapezoid* right = belows.back()->lower_right;
+  if (right != nullptr &&
+      (right != aboves.back()->upper_right || right->left != edge.right))
+    right = nullptr;
+
+  // Nodes of the edge are found among ancestors of its trapezoids,
+  // the walk stops at them, but other paths may lead up to the root.
+  std::vector<Node*> erased_nodes;
+  {
+    std::unordered_set<const Node*> visited;
+    std::vector<Node*> stack;
+    for (Trapezoid* trapezoid : belows)
+      stack.push_back(trapezoid->trapezoid_node);
+    for (Trapezoid* trapezoid : aboves)
+      stack.push_back(trapezoid->trapezoid_node);
+    while (!stack.empty()) {
+      Node* node = stack.back();
+      stack.pop_back();
+      for (Node* parent : node->get_parents()) {
+        if (!visited.insert(parent).second) continue;
+        if (parent->type == Node::Type_YNode &&
+            parent->data.ynode.edge == &edge)
+          erased_nodes.push_back(parent);
+        else
+          stack.push_back(parent);
+      }
+    }
+  }
+  if (left != nullptr)
+    erased_nodes.push_back(const_cast<Node*>(_root->search(*edge.left)));
+  if (right != nullptr)
+    erased_nodes.push_back(const_cast<Node*>(_root->search(*edge.right)));
+  for (Node* node : erased_nodes) {
+    assert((node->type == Node::Type_YNode ||
+            (node->type == Node::Type_XNode &&
+             (node->data.xnode.point == edge.left ||
+              node->data.xnode.point == edge.right))) &&
+           "Invalid erased node");
+    node->erased = true;
+    ++_erased_nodes_count;
+  }
+
+  // Region between the edges below and above the erased one is split
+  // by the points of both sides.
+  std::vector<Trapezoid*> merged;
+  std::vector<std::size_t> merged_belows, merged_aboves;
+  const Point* start = left != nullptr ? left->left : edge.left;
+  for (std::size_t below = 0, above = 0;;) {
+    bool last_below = below + 1 == belows.size();
+    bool last_above = above + 1 == aboves.size();
+    bool next_below = !last_below &&
+                      (last_above || aboves[above]->right->is_right_of(
+                                         *belows[below]->right));
+    const Point* end =
+        last_below && last_above
+            ? (right != nullptr ? right->right : edge.right)
+            : (next_below ? belows[below]->right : aboves[above]->right);
+    merged.push_back(_arena.create<Trapezoid>(
+        start, end, belows[below]->below, aboves[above]->above));
+    merged_belows.push_back(below);
+    merged_aboves.push_back(above);
+    if (last_below && last_above) break;
+    if (next_below)
+      ++below;
+    else
+      ++above;
+    start = end;
+  }
+
+  // Neighbours are either merged trapezoids or the ones beside the old.
+  std::size_t count = merged.size();
+  for (std::size_t index = 0; index < count; ++index) {
+    Trapezoid* trapezoid = merged[index];
+    Trapezoid* first_below = belows[merged_belows[index]];
+    Trapezoid* first_above = aboves[merged_aboves[index]];
+    if (index > 0 && &merged[index - 1]->below == &trapezoid->below)
+      trapezoid->set_lower_left(merged[index - 1]);
+    else
+      trapezoid->set_lower_left(index == 0 && left != nullptr
+                                    ? left->lower_left
+                                    : first_below->lower_left);
+    if (index > 0 && &merged[index - 1]->above == &trapezoid->above)
+      trapezoid->set_upper_left(merged[index - 1]);
+    else
+      trapezoid->set_upper_left(index == 0 && left != nullptr
+                                    ? left->upper_left
+                                    : first_above->upper_left);
+    if (index + 1 < count && &merged[index + 1]->below == &trapezoid->below)
+      trapezoid->set_lower_right(merged[index + 1]);
+    else
+      trapezoid->set_lower_right(index + 1 == count && right != nullptr
+                                     ? right->lower_right
+                                     : first_below->lower_right);
+    if (index + 1 < count && &merged[index + 1]->above == &trapezoid->above)
+      trapezoid->set_upper_right(merged[index + 1]);
+    else
+      trapezoid->set_upper_right(index + 1 == count && right != nullptr
+                                     ? right->upper_right
+                                     : first_above->upper_right);
+    _arena.create<Node>(trapezoid);
+  }
+
+  // Each old trapezoid is replaced by a router to merged trapezoids
+  // overlapping it.
+  for (std::size_t begin = 0, end; begin < count; begin = end) {
+    for (end = begin + 1;
+         end < count && merged_belows[end] == merged_belows[begin]; ++end)
+      ;
+    replace_node(belows[merged_belows[begin]]->trapezoid_node,
+                 create_router(merged, begin, end));
+  }
+  for (std::size_t begin = 0, end; begin < count; begin = end) {
+    for (end = begin + 1;
+         end < count && merged_aboves[end] == merged_aboves[begin]; ++end)
+      ;
+    replace_node(aboves[merged_aboves[begin]]->trapezoid_node,
+                 create_router(merged, begin, end));
+  }
+  if (left != nullptr)
+    replace_node(left->trapezoid_node, merged.front()->trapezoid_node);
+  if (right != nullptr)
+    replace_node(right->trapezoid_node, merged.back()->trapezoid_node);
+
+  for (std::vector<Trapezoid*>* olds : {&belows, &aboves})
+    for (Trapezoid* old : *olds) {
+      _arena.destroy(old->trapezoid_node);
+      _arena.destroy(old);
+    }
+  for (Trapezoid* old : {left, right})
+    if (old != nullptr) {
+      _arena.destroy(old->trapezoid_node);
+      _arena.destroy(old);
+    }
+}
+
+void TrapezoidalMap::replace_node(Node* node, Node* replacement) {
+  while (node->has_parents()) {
+    Node* parent = node->get_parents().front();
+    Node* sibling =
+        parent->type == Node::Type_XNode
+            ? (parent->data.xnode.left == node ? parent->data.xnode.right
+                                               : parent->data.xnode.left)
+            : (parent->data.ynode.below == node ? parent->data.ynode.above
+                                                : parent->data.ynode.below);
+    if (sibling != replacement) {
+      parent->replace_child(node, replacement);
+      continue;
+    }
+    // Parent does not split anything anymore.
+    replace_node(parent, replacement);
+    node->remove_parent(parent);
+    replacement->remove_parent(parent);
+    if (parent->erased) --_erased_nodes_count;
+    _arena.destroy(parent);
+  }
+  if (node == _root) _root = replacement;
+  if (_locator) _locator->replace(*node, *replacement);
+}
+
+Node* TrapezoidalMap::create_router(const std::vector<Trapezoid*>& trapezoids,
+                                    std::size_t begin, std::size_t end) {
+  if (end - begin == 1) return trapezoids[begin]->trapezoid_node;
+  std::size_t middle = begin + (end - begin) / 2;
+  return _arena.create<Node>(trapezoids[middle]->left,
+                             create_router(trapezoids, begin, middle),
+                             create_router(trapezoids, middle, end));
+}
+
+void TrapezoidalMap::rebuild() {
+  for (const Node* node : _root->collect_nodes()) {
+    if (node->type == Node::Type_TrapezoidNode)
+      _arena.destroy(node->data.trapezoid);
+    _arena.destroy(const_cast<Node*>(node));
+  }
+  _erased_nodes_count = 0;
+  _locator.reset();
+  std::vector<const Edge*> edges;
+  for (std::size_t index = 2; index < _edges.size() + _inserted_edges.size();
+       ++index)
+    if (index >= _erased_edges.size() || !_erased_edges[index])
+      edges.push_back(&get_edge(index));
+  _root = create_root();
+  insert_edges(edges, _order);
+}
+
+void TrapezoidalMap::save(const std::string& path) const {
+  std::vector<char> bytes = serialize();
+  std::ofstream stream(path, std::ios::binary);
+  if (stream) stream.write(bytes.data(), bytes.size());
+  if (!stream) throw std::runtime_error("Unable to write map to " + path);
+}
+
+std::unique_ptr<TrapezoidalMap> TrapezoidalMap::load(const std::string& path) {
+  std::ifstream stream(path, std::ios::binary | std::ios::ate);
+  if (!stream) throw std::runtime_error("Unable to read map from " + path);
+  std::vector<char> bytes(static_cast<std::size_t>(stream.tellg()));
+  stream.seekg(0);
+  if (!stream.read(bytes.data(), bytes.size()))
+    throw std::runtime_error("Unable to read map from " + path);
+  return deserialize(bytes.data(), bytes.size());
+}
+
+std::vector<char> TrapezoidalMap::serialize() const {
+  // Nodes are numbered in post-order, so children precede their parents
+  // and the root is the last one, trapezoids in order of their nodes.
+  const std::vector<const Node*> nodes = _root->collect_nodes_bottom_up();
+  std::unordered_map<const Node*, std::uint32_t> nodes_indices;
+  std::vector<const Trapezoid*> trapezoids;
+  std::unordered_map<const Trapezoid*, std::uint32_t> trapezoids_indices;
+  for (const Node* node : nodes) {
+    nodes_indices.emplace(node, nodes_indices.size());
+    if (node->type == Node::Type_TrapezoidNode) {
+      trapezoids_indices.emplace(node->data.trapezoid, trapezoids.size());
+      trapezoids.push_back(node->data.trapezoid);
+    }
+  }
+  if (nodes.size() >= MAP_NO_INDEX ||
+      _points.size() + _inserted_points.size() >= MAP_NO_INDEX ||
+      _edges.size() + _inserted_edges.size() >= MAP_NO_INDEX)
+    throw std::runtime_error("Map is too large to be saved.");
+
+  // Inserted points are numbered after the initial ones.
+  auto point_index = [this](const Point* point) -> std::uint64_t {
+    return is_initial(*point) ? point - _points.data() : get_index(*point) + 4;
+  };
+  auto trapezoid_index = [&](const Trapezoid* trapezoid) -> std::uint64_t {
+    return trapezoid == nullptr ? MAP_NO_INDEX
+                                : trapezoids_indices.at(trapezoid);
+  };
+
+  ByteWriter writer;
+  for (char byte : MAP_MAGIC) writer.write(static_cast<unsigned char>(byte), 1);
+  writer.write(MAP_FORMAT_VERSION, 4);
+  writer.write(0, 4);
+  writer.write(_seed, 8);
+  writer.write(_order, 1);
+  for (std::size_t count :
+       {_points.size(), _rings_offsets.size(), _inserted_points.size(),
+        _edges.size(), _inserted_edges.size(), _inserted_rings_count,
+        _faces.size(), _erased_edges.size(), trapezoids.size(), nodes.size()})
+    writer.write(count, 8);
+  for (const Point& point : _points) {
+    writer.write_double(point.x);
+    writer.write_double(point.y);
+  }
+  for (std::size_t offset : _rings_offsets) writer.write(offset, 8);
+  for (const InsertedPoint& point : _inserted_points) {
+    writer.write_double(point.x);
+    writer.write_double(point.y);
+    writer.write(static_cast<std::uint64_t>(point.ring), 8);
+  }
+  for (const Edge& edge : _edges) {
+    writer.write(point_index(edge.left), 4);
+    writer.write(point_index(edge.right), 4);
+  }
+  for (const InsertedEdge& edge : _inserted_edges) {
+    writer.write(point_index(edge.left), 4);
+    writer.write(point_index(edge.right), 4);
+    writer.write(static_cast<std::uint64_t>(edge.ring), 8);
+  }
+  for (bool interior_below : _interiors_below) writer.write(interior_below, 1);
+  for (const Faces& faces : _faces) {
+    writer.write(static_cast<std::uint64_t>(faces.first), 8);
+    writer.write(static_cast<std::uint64_t>(faces.second), 8);
+  }
+  for (bool erased : _erased_edges) writer.write(erased, 1);
+  for (const Trapezoid* trapezoid : trapezoids) {
+    writer.write(point_index(trapezoid->left), 4);
+    writer.write(point_index(trapezoid->right), 4);
+    writer.write(get_index(trapezoid->below), 4);
+    writer.write(get_index(trapezoid->above), 4);
+    writer.write(trapezoid_index(trapezoid->lower_left), 4);
+    writer.write(trapezoid_index(trapezoid->lower_right), 4);
+    writer.write(trapezoid_index(trapezoid->upper_left), 4);
+    writer.write(trapezoid_index(trapezoid->upper_right), 4);
+  }
+  for (const Node* node : nodes) {
+    writer.write(node->type, 1);
+    writer.write(node->erased, 1);
+    switch (node->type) {
+      case Node::Type_XNode:
+        writer.write(point_index(node->data.xnode.point), 4);
+        writer.write(nodes_indices.at(node->data.xnode.left), 4);
+        writer.write(nodes_indices.at(node->data.xnode.right), 4);
+        break;
+      case Node::Type_YNode:
+        writer.write(get_index(*node->data.ynode.edge), 4);
+        writer.write(nodes_indices.at(node->data.ynode.below), 4);
+        writer.write(nodes_indices.at(node->data.ynode.above), 4);
+        break;
+      case Node::Type_TrapezoidNode:
+        writer.write(trapezoids_indices.at(node->data.trapezoid), 4);
+        writer.write(0, 8);
+        break;
+    }
+  }
+  return std::move(writer.bytes());
+}
+
+std::unique_ptr<TrapezoidalMap> TrapezoidalMap::deserialize(
+    const char* data, std::size_t size) {
+  ByteReader reader(data, size);
+  for (char byte : MAP_MAGIC)
+    if (reader.read(1) != static_cast<unsigned char>(byte))
+      throw std::runtime_error("Data is not a saved map.");
+  if (reader.read(4) != MAP_FORMAT_VERSION)
+    throw std::runtime_error("Unsupported version of the map format.");
+  std::unique_ptr<TrapezoidalMap> result(new TrapezoidalMap());
+  TrapezoidalMap& map = *result;
+  if (reader.read(4) != 0)
+    throw std::runtime_error("Unsupported flags of the map format.");
+  map._seed = reader.read(8);
+  std::uint64_t order = reader.read(1);
+  if (order > Order_Brio) throw std::runtime_error("Data is corrupted.");
+  map._order = static_cast<Order>(order);
+  std::size_t points_count = reader.read_count(MAP_POINT_SIZE);
+  std::size_t rings_count = reader.read_count(8);
+  std::size_t inserted_points_count = reader.read_count(MAP_POINT_SIZE);
+  std::size_t edges_count = reader.read_count(MAP_EDGE_SIZE);
+  std::size_t inserted_edges_count = reader.read_count(MAP_EDGE_SIZE);
+  map._inserted_rings_count = static_cast<std::size_t>(reader.read(8));
+  std::size_t faces_count = reader.read_count(16);
+  std::size_t erased_edges_count = reader.read_count(1);
+  std::size_t trapezoids_count = reader.read_count(MAP_TRAPEZOID_SIZE);
+  std::size_t nodes_count = reader.read_count(MAP_NODE_SIZE);
+  std::size_t all_points_count = points_count + inserted_points_count;
+  std::size_t all_edges_count = edges_count + inserted_edges_count;
+  if (points_count < 4 || edges_count < 2 ||
+      (faces_count != 0 && faces_count != all_edges_count - 2) ||
+      erased_edges_count > all_edges_count ||
+      trapezoids_count == 0 || nodes_count == 0)
+    throw std::runtime_error("Data is corrupted.");
+
+  map._points.reserve(points_count);
+  for (std::size_t index = 0; index < points_count; ++index) {
+    double x = reader.read_double();
+    map._points.emplace_back(x, reader.read_double());
+  }
+  map._rings_offsets.reserve(rings_count);
+  for (std::size_t index = 0; index < rings_count; ++index)
+    map._rings_offsets.push_back(static_cast<std::size_t>(reader.read(8)));
+  for (std::size_t index = 0; index < inserted_points_count; ++index) {
+    double x = reader.read_double();
+    double y = reader.read_double();
+    map._inserted_points.emplace_back(
+        Point(x, y), points_count - 4 + index,
+        static_cast<std::int64_t>(reader.read(8)));
+  }
+  auto read_point = [&]() -> const Point* {
+    std::size_t index = reader.read_index(all_points_count);
+    if (index < points_count) return &map._points[index];
+    return &map._inserted_points[index - points_count];
+  };
+  auto read_endpoints = [&](const Point*& left, const Point*& right) {
+    left = read_point();
+    right = read_point();
+    if (!right->is_right_of(*left))
+      throw std::runtime_error("Data is corrupted.");
+  };
+  map._edges.reserve(edges_count);
+  for (std::size_t index = 0; index < edges_count; ++index) {
+    const Point* left;
+    const Point* right;
+    read_endpoints(left, right);
+    if (!map.is_initial(*left) || !map.is_initial(*right))
+      throw std::runtime_error("Data is corrupted.");
+    map._edges.emplace_back(left, right);
+  }
+  for (std::size_t index = 0; index < inserted_edges_count; ++index) {
+    const Point* left;
+    const Point* right;
+    read_endpoints(left, right);
+    map._inserted_edges.emplace_back(
+        left, right, edges_count + index,
+        static_cast<std::int64_t>(reader.read(8)));
+  }
+  map._interiors_below.reserve(all_edges_count);
+  for (std::size_t index = 0; index < all_edges_count; ++index)
+    map._interiors_below.push_back(reader.read(1) != 0);
+  map._faces.reserve(faces_count);
+  for (std::size_t index = 0; index < faces_count; ++index) {
+    std::int64_t below = static_cast<std::int64_t>(reader.read(8));
+    map._faces.emplace_back(below, static_cast<std::int64_t>(reader.read(8)));
+  }
+  map._erased_edges.reserve(erased_edges_count);
+  for (std::size_t index = 0; index < erased_edges_count; ++index) {
+    map._erased_edges.push_back(reader.read(1) != 0);
+    if (map._erased_edges.back()) ++map._erased_edges_count;
+  }
+
+  // Neighbours are linked once all trapezoids are created.
+  map._arena.reserve(trapezoids_count * sizeof(Trapezoid) +
+                     nodes_count * sizeof(Node));
+  std::vector<Trapezoid*> trapezoids;
+  trapezoids.reserve(trapezoids_count);
+  std::vector<std::uint32_t> neighbours;
+  neighbours.reserve(4 * trapezoids_count);
+  for (std::size_t index = 0; index < trapezoids_count; ++index) {
+    const Point* left;
+    const Point* right;
+    read_endpoints(left, right);
+    const Edge& below = map.get_edge(reader.read_index(all_edges_count));
+    const Edge& above = map.get_edge(reader.read_index(all_edges_count));
+    trapezoids.push_back(
+        map._arena.create<Trapezoid>(left, right, below, above));
+    for (int side = 0; side < 4; ++side) {
+      std::uint64_t neighbour = reader.read(4);
+      if (neighbour != MAP_NO_INDEX && neighbour >= trapezoids_count)
+        throw std::runtime_error("Data is corrupted.");
+      neighbours.push_back(static_cast<std::uint32_t>(neighbour));
+    }
+  }
+  auto get_neighbour = [&](std::size_t index) -> Trapezoid* {
+    return neighbours[index] == MAP_NO_INDEX ? nullptr
+                                             : trapezoids[neighbours[index]];
+  };
+  for (std::size_t index = 0; index < trapezoids_count; ++index) {
+    Trapezoid* trapezoid = trapezoids[index];
+    trapezoid->lower_left = get_neighbour(4 * index);
+    trapezoid->lower_right = get_neighbour(4 * index + 1);
+    trapezoid->upper_left = get_neighbour(4 * index + 2);
+    trapezoid->upper_right = get_neighbour(4 * index + 3);
+  }
+
+  // Children precede their parents, so they are created first.
+  std::vector<Node*> nodes;
+  nodes.reserve(nodes_count);
+  for (std::size_t index = 0; index < nodes_count; ++index) {
+    std::uint64_t type = reader.read(1);
+    bool erased = reader.read(1) != 0;
+    Node* node;
+    if (type == Node::Type_TrapezoidNode) {
+      Trapezoid* trapezoid = trapezoids[reader.read_index(trapezoids_count)];
+      if (trapezoid->trapezoid_node != nullptr || reader.read(8) != 0)
+        throw std::runtime_error("Data is corrupted.");
+      node = map._arena.create<Node>(trapezoid);
+    } else {
+      std::size_t value = reader.read(4);
+      Node* first = nodes[reader.read_index(nodes.size())];
+      Node* second = nodes[reader.read_index(nodes.size())];
+      if (first == second) throw std::runtime_error("Data is corrupted.");
+      if (type == Node::Type_XNode && value < all_points_count)
+        node = map._arena.create<Node>(
+            value < points_count ? &map._points[value]
+                                 : &map._inserted_points[value - points_count],
+            first, second);
+      else if (type == Node::Type_YNode && value < all_edges_count)
+        node = map._arena.create<Node>(&map.get_edge(value), first, second);
+      else
+        throw std::runtime_error("Data is corrupted.");
+    }
+    node->erased = erased;
+    if (erased) ++map._erased_nodes_count;
+    nodes.push_back(node);
+  }
+  if (!reader.at_end()) throw std::runtime_error("Data is corrupted.");
+  for (Trapezoid* trapezoid : trapezoids)
+    if (trapezoid->trapezoid_node == nullptr)
+      throw std::runtime_error("Data is corrupted.");
+  for (std::size_t index = 0; index + 1 < nodes_count; ++index)
+    if (!nodes[index]->has_parents())
+      throw std::runtime_error("Data is corrupted.");
+  map._root = nodes.back();
+  map._root->assert_valid();
+  return result;
+}
+
+bool TrapezoidalMap::is_initial(const Point& point) const {
+  std::less<const Point*> less;
+  return !less(&point, _points.data()) &&
+         less(&point, _points.data() + _points.size());
+}
+
+bool TrapezoidalMap::is_initial(const Edge& edge) const {
+  std::less<const Edge*> less;
+  return !less(&edge, _edges.data()) &&
+         less(&edge, _edges.data() + _edges.size());
+}
+
+std::size_t TrapezoidalMap::get_index(const Point& point) const {
+  if (is_initial(point)) return &point - _points.data();
+  return static_cast<const InsertedPoint&>(point).index;
+}
+
+std::size_t TrapezoidalMap::get_index(const Edge& edge) const {
+  if (is_initial(edge)) return &edge - _edges.data();
+  return static_cast<const InsertedEdge&>(edge).index;
+}
+
+std::int64_t TrapezoidalMap::get_ring(const Point& point) const {
+  if (!is_initial(point)) return static_cast<const InsertedPoint&>(point).ring;
+  std::size_t index = &point - _points.data();
+  if (index >= _points.size() - 4) return -1;
+  return std::upper_bound(_rings_offsets.begin(), _rings_offsets.end(),
+                          index) -
+         _rings_offsets.begin() - 1;
+}
+
+std::int64_t TrapezoidalMap::get_ring(const Edge& edge) const {
+  if (!is_initial(edge)) return static_cast<const InsertedEdge&>(edge).ring;
+  return get_ring(*edge.left);
+}
+
+std::int64_t TrapezoidalMap::get_ring(const Trapezoid& trapezoid) const {
+  // Edge above the trapezoid belongs either to the innermost ring
+  // enclosing it or to a hole in the border ring,
+  // free segments are passed through to the trapezoids above them,
+  // which are inside of the same rings.
+  const Edge* above = &trapezoid.above;
+  std::int64_t ring = get_ring(*above);
+  while (ring < 0 && rings_count() > 0 && get_index(*above) >= 2) {
+    above = &_root->search_adjacent(*above, true)->above;
+    ring = get_ring(*above);
+  }
+  if (ring < 0 || _interiors_below[get_index(*above)]) return ring;
+  return ring == 0 ? -1 : 0;
+}
+
+std::int64_t TrapezoidalMap::get_face(const Trapezoid& trapezoid) const {
+  if (_faces.empty()) return -1;
+  // Trapezoid is in the face below its above edge
+  // unless it is the top edge of enclosing rectangle.
+  std::size_t above = get_index(trapezoid.above);
+  if (above >= 2) return _faces[above - 2].first;
+  std::size_t below = get_index(trapezoid.below);
+  if (below >= 2) return _faces[below - 2].second;
+  return -1;
+}
+
+void TrapezoidalMap::locate_faces(const double* coordinates,
+                                  std::size_t count, std::int64_t* values,
+                                  std::uint8_t* kinds) const {
+  for (std::size_t index = 0; index < count; ++index) {
+    const Node* node = _root->search(
+        Point(coordinates[2 * index], coordinates[2 * index + 1]));
+    switch (node->type) {
+      case Node::Type_XNode:
+        kinds[index] = Locator::Kind_Point;
+        values[index] = get_index(*node->data.xnode.point);
+        break;
+      case Node::Type_YNode:
+        kinds[index] = Locator::Kind_Edge;
+        values[index] = get_index(*node->data.ynode.edge) - 2;
+        break;
+      case Node::Type_TrapezoidNode:
+        kinds[index] = Locator::Kind_Trapezoid;
+        values[index] = get_face(*node->data.trapezoid);
+        break;
+    }
+  }
+}
+
+void TrapezoidalMap::locate_rings(const double* coordinates,
+                                  std::size_t count, std::int64_t* rings,
+                                  std::uint8_t* kinds) const {
+  for (std::size_t index = 0; index < count; ++index) {
+    const Node* node = _root->search(
+        Point(coordinates[2 * index], coordinates[2 * index + 1]));
+    switch (node->type) {
+      case Node::Type_XNode:
+        kinds[index] = Locator::Kind_Point;
+        rings[index] = get_ring(*node->data.xnode.point);
+        break;
+      case Node::Type_YNode:
+        kinds[index] = Locator::Kind_Edge;
+        rings[index] = get_ring(*node->data.ynode.edge);
+        break;
+      case Node::Type_TrapezoidNode:
+        kinds[index] = Locator::Kind_Trapezoid;
+        rings[index] = get_ring(*node->data.trapezoid);
+        break;
+    }
+  }
+}
+
+bool TrapezoidalMap::add_edge(const Edge& edge, const Node* start) {
+  std::vector<Trapezoid*> trapezoids;
+  {
+    StageTimer timer(
+        get_stage(_build_profile.get(), &BuildProfile::find_trapezoids));
+    if (!find_trapezoids_intersecting_edge(
+            edge, start == nullptr ? *_root : *start, trapezoids))
+      return false;
+  }
+  if (_build_profile)
+    _build_profile->crossed_trapezoids_counts.push_back(trapezoids.size());
+  add_edge(edge, trapezoids);
+  return true;
+}
+
+void TrapezoidalMap::add_edge(const Edge& edge,
+                              const std::vector<Trapezoid*>& trapezoids) {
   assert(!trapezoids.empty() && "No trapezoids intersect edge");
 
-  const Point* p = edge.left;
-  const Point* q = edge.right;
+  const Point* p = get_clipped_left(edge);
+  const Point* q = get_clipped_right(edge);
   Trapezoid* left_old = nullptr;    // old trapezoid to the left.
   Trapezoid* left_below = nullptr;  // below trapezoid to the left.
   Trapezoid* left_above = nullptr;  // above trapezoid to the left.
@@ -117,8 +1690,8 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
     Trapezoid* old = trapezoids[i];  // old trapezoid to replace.
     bool start_trap = (i == 0);
     bool end_trap = (i == ntraps - 1);
-    bool have_left = (start_trap && edge.left != old->left);
-    bool have_right = (end_trap && edge.right != old->right);
+    bool have_left = (start_trap && p != old->left);
+    bool have_right = (end_trap && q != old->right);
 
     // Old trapezoid is replaced by up to 4 new trapezoids: left is to the
     // left of the start point p, below/above are below/above the edge
@@ -135,11 +1708,12 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
     // interleave the 4 different cases with many more if-statements.
     if (start_trap && end_trap) {
       // Edge intersects a single trapezoid.
-      if (have_left) left = new Trapezoid(old->left, p, old->below, old->above);
-      below = new Trapezoid(p, q, old->below, edge);
-      above = new Trapezoid(p, q, edge, old->above);
+      if (have_left)
+        left = create_trapezoid(old->left, p, old->below, old->above);
+      below = create_trapezoid(p, q, old->below, edge);
+      above = create_trapezoid(p, q, edge, old->above);
       if (have_right)
-        right = new Trapezoid(q, old->right, old->below, old->above);
+        right = create_trapezoid(q, old->right, old->below, old->above);
 
       // Set pairs of trapezoid neighbours.
       if (have_left) {
@@ -164,9 +1738,10 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
     } else if (start_trap) {
       // Old trapezoid is the first of 2+ trapezoids that the edge
       // intersects.
-      if (have_left) left = new Trapezoid(old->left, p, old->below, old->above);
-      below = new Trapezoid(p, old->right, old->below, edge);
-      above = new Trapezoid(p, old->right, edge, old->above);
+      if (have_left)
+        left = create_trapezoid(old->left, p, old->below, old->above);
+      below = create_trapezoid(p, old->right, old->below, edge);
+      above = create_trapezoid(p, old->right, edge, old->above);
 
       // Set pairs of trapezoid neighbours.
       if (have_left) {
@@ -188,16 +1763,16 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
         below = left_below;
         below->right = q;
       } else
-        below = new Trapezoid(old->left, q, old->below, edge);
+        below = create_trapezoid(old->left, q, old->below, edge);
 
       if (left_above->above == old->above) {
         above = left_above;
         above->right = q;
       } else
-        above = new Trapezoid(old->left, q, edge, old->above);
+        above = create_trapezoid(old->left, q, edge, old->above);
 
       if (have_right)
-        right = new Trapezoid(q, old->right, old->below, old->above);
+        right = create_trapezoid(q, old->right, old->below, old->above);
 
       // Set pairs of trapezoid neighbours.
       if (have_right) {
@@ -233,13 +1808,13 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
         below = left_below;
         below->right = old->right;
       } else
-        below = new Trapezoid(old->left, old->right, old->below, edge);
+        below = create_trapezoid(old->left, old->right, old->below, edge);
 
       if (left_above->above == old->above) {
         above = left_above;
         above->right = old->right;
       } else
-        above = new Trapezoid(old->left, old->right, edge, old->above);
+        above = create_trapezoid(old->left, old->right, edge, old->above);
 
       // Connect to new trapezoids replacing prevOld.
       if (below != left_below) {  // below is new.
@@ -264,23 +1839,40 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
 
     // Create new nodes to add to search graph.  Below and above trapezoids
     // may already have owning trapezoid nodes, in which case reuse them.
-    Node* new_top_node = new Node(
-        &edge, below == left_below ? below->trapezoid_node : new Node(below),
-        above == left_above ? above->trapezoid_node : new Node(above));
-    if (have_right) new_top_node = new Node(q, new_top_node, new Node(right));
-    if (have_left) new_top_node = new Node(p, new Node(left), new_top_node);
+    Node* new_top_node = create_node(
+        &edge,
+        below == left_below ? below->trapezoid_node : create_node(below),
+        above == left_above ? above->trapezoid_node : create_node(above));
+    if (have_right)
+      new_top_node = create_node(q, new_top_node, create_node(right));
+    if (have_left)
+      new_top_node = create_node(p, create_node(left), new_top_node);
 
     // Insert new_top_node in correct position or positions in search graph.
     Node* old_node = old->trapezoid_node;
-    if (old_node == _root)
-      _root = new_top_node;
-    else
-      old_node->replace_with(new_top_node);
+    if (_keep_replaced) {
+      // Old node becomes new_top_node in place, so its parents and
+      // searches started from it need no update.
+      assert(!_locator && "Locator should not be created");
+      StageTimer timer(
+          get_stage(_build_profile.get(), &BuildProfile::replace_nodes));
+      old_node->take_over(*new_top_node);
+      _arena.destroy(new_top_node);
+    } else {
+      if (old_node == _root)
+        _root = new_top_node;
+      else {
+        StageTimer timer(
+            get_stage(_build_profile.get(), &BuildProfile::replace_nodes));
+        old_node->replace_with(new_top_node);
+      }
+      if (_locator) _locator->replace(*old_node, *new_top_node);
 
-    // old_node has been removed from all of its parents and is no longer
-    // needed.
-    assert(old_node->parents.empty() && "Node should have no parents");
-    delete old_node;
+      // old_node has been removed from all of its parents and is no longer
+      // needed, but is destroyed after all trapezoids are replaced since
+      // the old ones are still compared with neighbours of the following.
+      assert(!old_node->has_parents() && "Node should have no parents");
+    }
 
     // Clearing up.
     if (!end_trap) {
@@ -291,37 +1883,52 @@ bool TrapezoidalMap::add_edge(const Edge& edge) {
     }
   }
 
-  return true;
+  for (Trapezoid* old : trapezoids) {
+    if (!_keep_replaced) _arena.destroy(old->trapezoid_node);
+    _arena.destroy(old);
+  }
+}
+
+const Point* TrapezoidalMap::get_clipped_left(const Edge& edge) const {
+  return _slab_left != nullptr && _slab_left->is_right_of(*edge.left)
+             ? _slab_left
+             : edge.left;
+}
+
+const Point* TrapezoidalMap::get_clipped_right(const Edge& edge) const {
+  return _slab_right != nullptr && edge.right->is_right_of(*_slab_right)
+             ? _slab_right
+             : edge.right;
 }
 
 bool TrapezoidalMap::find_trapezoids_intersecting_edge(
-    const Edge& edge, std::vector<Trapezoid*>& trapezoids) {
+    const Edge& edge, const Node& start, std::vector<Trapezoid*>& trapezoids) {
   // This is the FollowSegment algorithm of de Berg et al, with some extra
   // checks to deal with simple collinear (i.e. invalid) triangles.
   trapezoids.clear();
-  Trapezoid* trapezoid = _root->search(edge);
-  if (trapezoid == nullptr) {
-    assert(trapezoid != nullptr && "search(edge) returns null trapezoid");
-    return false;
+  Trapezoid* trapezoid;
+  {
+    StageTimer timer(
+        get_stage(_build_profile.get(), &BuildProfile::search_edge));
+    trapezoid = start.search(edge);
   }
+  // Edge lies along an existing one.
+  if (trapezoid == nullptr) return false;
 
   trapezoids.push_back(trapezoid);
-  while (edge.right->is_right_of(*trapezoid->right)) {
+  const Point* end = get_clipped_right(edge);
+  while (end->is_right_of(*trapezoid->right)) {
     int orient = edge.get_point_orientation(*trapezoid->right);
-    if (orient == 0) {
-      assert(0 && "Unable to deal with point on edge");
-      return false;
-    }
+    // Edge passes through a point.
+    if (orient == 0) return false;
 
     if (orient == -1)
       trapezoid = trapezoid->lower_right;
     else if (orient == +1)
       trapezoid = trapezoid->upper_right;
 
-    if (trapezoid == nullptr) {
-      assert(0 && "Expected trapezoid neighbor");
-      return false;
-    }
+    // Edge crosses an edge of the enclosing rectangle.
+    if (trapezoid == nullptr) return false;
     trapezoids.push_back(trapezoid);
   }
 
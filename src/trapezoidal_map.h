@@ -2,13 +2,23 @@
 #define TRAPEZOIDAL_MAP_H
 
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "arena.h"
 #include "edge.h"
+#include "locator.h"
 #include "node.h"
 #include "point.h"
 #include "trapezoid.h"
 
+class ThreadPool;
+
 /* Implemented using the trapezoid map algorithm from the book
  * "Computational Geometry, Algorithms and Applications", second edition,
  * by M. de Berg, M. van Kreveld, M. Overmars and O. Schwarzkopf.
@@ -29,6 +39,8 @@
  *
  * Nodes can be repeated throughout the search graph, and each is reference
  * counted through the multiple parent nodes it is a child of.
+ * All nodes and trapezoids are allocated from the Arena owned by the map
+ * (or by maps of its slabs), so they are released at once together with it.
  *
  * The algorithm is only intended to work with valid decompositions, i.e. it
  * must not contain duplicate points, triangles formed from collinear points,
@@ -39,27 +51,465 @@
  */
 class TrapezoidalMap {
  public:
-  TrapezoidalMap(const std::vector<Point>&, bool shuffle);
+  // Indices of endpoints of a segment.
+  typedef std::pair<std::size_t, std::size_t> Segment;
+  // Labels of faces below and above a segment (to the right and to the left
+  // of a vertical one).
+  typedef std::pair<std::int64_t, std::int64_t> Faces;
+  // Readers-writer lock of the map, std::shared_mutex is C++17 only.
+#if __cplusplus >= 201703L
+  typedef std::shared_mutex Mutex;
+#else
+  typedef std::shared_timed_mutex Mutex;
+#endif
+
+  // Seed of the shuffle of edges if none is specified.
+  static const std::uint64_t DEFAULT_SEED = 1234;
+
+  /* Orders of insertion of edges: the input one, the seeded shuffle
+   * and the biased randomized insertion order (BRIO) of N. Amenta,
+   * S. Choi and G. Rote, which splits the shuffle into rounds
+   * of doubling sizes (each edge is in the last round with probability 1/2,
+   * in the previous one with probability 1/4 and so on) and sorts edges
+   * of each round by the Hilbert curve order of their midpoints.
+   * Consecutive insertions of BRIO walk nearby parts of the search graph,
+   * so construction has better locality of memory accesses,
+   * while randomness of rounds keeps the expected depth of the shuffle. */
+  enum Order { Order_Input, Order_Shuffle, Order_Brio };
+
+  /* Shape of the search graph: numbers of its nodes by type,
+   * of nodes with more than 1 parent and of child-to-parent links,
+   * depths of leaves as numbers of branch nodes on the longest path
+   * from the root to them and sizes of objects of the map
+   * (not including overheads of their containers and of the arena). */
+  struct Stats {
+    std::size_t x_nodes_count = 0;
+    std::size_t y_nodes_count = 0;
+    std::size_t leaves_count = 0;
+    std::size_t shared_nodes_count = 0;
+    std::size_t parents_links_count = 0;
+    std::size_t max_leaf_depth = 0;
+    double average_leaf_depth = 0.;
+    std::size_t nodes_bytes = 0;
+    std::size_t trapezoids_bytes = 0;
+    std::size_t points_bytes = 0;
+    std::size_t edges_bytes = 0;
+  };
+
+  /* Cumulative wall-clock times and numbers of calls of the stages
+   * of edges insertion, numbers of trapezoids crossed by each edge
+   * in order of insertion and sizes of allocated nodes and trapezoids
+   * (one call of allocation stages per object).
+   * Stages are nested: searches are made by finding of the crossed
+   * trapezoids and allocations with replacements by the insertion. */
+  struct BuildProfile {
+    struct Stage {
+      std::size_t calls = 0;
+      double seconds = 0.;
+    };
+
+    Stage search_edge;            // Node::search(const Edge&).
+    Stage find_trapezoids;        // find_trapezoids_intersecting_edge.
+    Stage allocate_trapezoids;
+    Stage allocate_nodes;
+    Stage replace_nodes;          // Node::replace_with.
+    std::vector<std::size_t> crossed_trapezoids_counts;
+    std::size_t trapezoids_bytes = 0;
+    std::size_t nodes_bytes = 0;
+    std::size_t arena_bytes = 0;  // Blocks requested by arenas.
+  };
+
+  /* Map of polygon given by points of its border,
+   * edges are inserted in the order of the seeded shuffle if shuffle
+   * (the same on all platforms for the same seed),
+   * profile enables the BuildProfile of insertions of edges
+   * made by construction and following updates (so it costs
+   * a few clock readings per allocation of each node and trapezoid). */
+  TrapezoidalMap(const std::vector<Point>&, bool shuffle,
+                 bool profile = false, std::uint64_t seed = DEFAULT_SEED);
+  // Map of polygon with edges inserted in the specified Order.
+  TrapezoidalMap(const std::vector<Point>&, Order order, bool profile = false,
+                 std::uint64_t seed = DEFAULT_SEED);
+  /* Map of polygon with holes given by points of all its rings one after
+   * another and indices of the first points of rings,
+   * the first ring is the border and the rest are holes in it. */
+  TrapezoidalMap(const std::vector<Point>&,
+                 const std::vector<std::size_t>& rings_offsets, bool shuffle,
+                 bool profile = false, std::uint64_t seed = DEFAULT_SEED);
+  TrapezoidalMap(const std::vector<Point>&,
+                 const std::vector<std::size_t>& rings_offsets, Order order,
+                 bool profile = false, std::uint64_t seed = DEFAULT_SEED);
+  /* Map of planar subdivision given by points and non-crossing segments
+   * between them, optionally labelling faces on both sides of each segment
+   * (faces should be either empty or have the same size as segments). */
+  TrapezoidalMap(const std::vector<Point>&,
+                 const std::vector<Segment>& segments,
+                 const std::vector<Faces>& faces, bool shuffle,
+                 bool profile = false, std::uint64_t seed = DEFAULT_SEED);
+#ifdef ARENA_HAS_MEMORY_RESOURCE
+  // Nodes and trapezoids are allocated from blocks of the upstream resource.
+  TrapezoidalMap(const std::vector<Point>&, bool shuffle,
+                 std::pmr::memory_resource* upstream);
+  TrapezoidalMap(const std::vector<Point>&, Order order,
+                 std::pmr::memory_resource* upstream);
+#endif
+  /* Parallel construction: the bounding box is split into slabs_count
+   * vertical slabs (number of workers of the pool if zero) holding roughly
+   * the same number of points, each slab gets its own map of edges
+   * which intersect it, and maps are built concurrently on the pool.
+   * Boundaries of slabs are vertical lines through contour points
+   * (sheared by the order of points like the walls of trapezoids),
+   * edges crossing them are clipped by them without new points,
+   * so trapezoids of a slab map are bounded by its boundaries.
+   * Trapezoids on both sides of a boundary which are separated
+   * by it only are merged afterwards and the rest are linked
+   * as neighbours of the ones beside the wall of the boundary point,
+   * so the trapezoids are the same as the ones of the sequential map.
+   * Root of the search graph is a tree of XNodes for slabs boundaries
+   * routing to the roots of slabs maps, after that the map is updated
+   * like the sequential one.
+   * Profiles of slabs are summed, so their times are totals
+   * over all workers. */
+  TrapezoidalMap(const std::vector<Point>&, bool shuffle, ThreadPool& pool,
+                 std::size_t slabs_count = 0, bool profile = false,
+                 std::uint64_t seed = DEFAULT_SEED);
+
+  /* Build maps of polygon with holes (given like in the constructor)
+   * with seeds following the specified one until one of them has
+   * the maximal depth of the search graph (Stats::max_leaf_depth)
+   * not exceeding depth_factor * log2(N) for N edges
+   * or candidates_count maps are built, returning the shallowest one.
+   * With zero depth_factor all of the candidates are built.
+   * Candidates are built concurrently on the pool if it is not null,
+   * one per worker at a time. */
+  static std::unique_ptr<TrapezoidalMap> build_shallowest(
+      const std::vector<Point>&, const std::vector<std::size_t>& rings_offsets,
+      std::size_t candidates_count, std::uint64_t seed = DEFAULT_SEED,
+      double depth_factor = 0., ThreadPool* pool = nullptr);
+
+  /* Map of polygon with holes (given like in the constructor) built
+   * by the phased construction of R. Seidel: edges are inserted
+   * in the same seeded random order as by the shuffling constructor
+   * (so the resulting search graph is the same as its one)
+   * in log* N phases, after each phase rings are traced through
+   * the current trapezoids to locate the left endpoints of the remaining
+   * edges, so their insertions search only the part of the graph created
+   * since then rather than the whole one.
+   * Nodes of replaced trapezoids are turned into their replacements
+   * in place, so located nodes stay valid without any bookkeeping.
+   * This cuts the time spent searching for edges about 6 times
+   * and the total construction time about 1.7 times
+   * compared to the shuffling constructor for 200k vertices. */
+  static std::unique_ptr<TrapezoidalMap> build_phased(
+      const std::vector<Point>&, const std::vector<std::size_t>& rings_offsets,
+      std::uint64_t seed = DEFAULT_SEED, bool profile = false);
 
   ~TrapezoidalMap();
 
   const Node& root() const { return *_root; }
 
+  /* Return the lock guarding the map against concurrent edits:
+   * insertions and erasures of edges hold it exclusively,
+   * so searches running in other threads while the map may be edited
+   * should hold it shared for as long as they use its nodes,
+   * trapezoids or Locator. */
+  Mutex& mutex() const { return _mutex; }
+
+  /* Return Locator of the search graph, it is created on the first call
+   * and reused by the following ones, insertions and erasures of edges
+   * update it in place of the replaced nodes. */
+  const Locator& locator() const;
+
+  std::size_t rings_count() const {
+    return _rings_offsets.size() + _inserted_rings_count;
+  }
+
+  /* Insert edge between the specified points into the search graph
+   * of the constructed map, returning index of its segment:
+   * segments are numbered after the ones of the constructor
+   * in order of insertion and do not bound rings.
+   * Endpoints which coincide with points of the map's edges are shared
+   * with them, new points are numbered after the points of the constructor.
+   * Edge should lie inside of the enclosing rectangle of the map
+   * and not cross, overlap or touch any of its edges
+   * (besides at their shared endpoints), which is checked
+   * before the map is changed.
+   * Trapezoids and nodes crossed by the edge are destroyed,
+   * so references to them obtained before the insertion are invalidated. */
+  std::size_t insert_edge(const Point& start, const Point& end,
+                          const Faces& faces = Faces(-1, -1));
+
+  /* Insert edges of the closed contour as a new ring of the map:
+   * the border if it has no rings yet or a hole otherwise,
+   * returning index of the ring.
+   * If an edge can not be inserted the preceding ones are removed
+   * and the search graph is rebuilt from scratch. */
+  std::size_t insert_contour(const std::vector<Point>& contour);
+
+  /* Erase the segment with the specified index from the map:
+   * trapezoids below and above it are merged (together with the ones
+   * beside its endpoints which are not of other segments)
+   * and their nodes are replaced by subgraphs locating the merged ones.
+   * Nodes of the erased edge and endpoints are kept to route the search,
+   * once they outnumber the remaining segments the search graph
+   * is rebuilt from scratch in the order of the construction.
+   * Nodes of the edge are found by walking up from the merged trapezoids,
+   * which stops at them, but other paths may lead up to the root,
+   * so an erasure takes time linear in the number of ancestors
+   * of the trapezoids, which is up to the size of the whole graph.
+   * Merged trapezoids and nodes are destroyed,
+   * so references to them obtained before the erasure are invalidated. */
+  void erase_edge(std::size_t segment);
+
+  // Number of insertions & erasures made after construction.
+  std::size_t version() const { return _version; }
+
+  // Gather Stats in a single pass over the search graph.
+  Stats stats() const;
+
+  bool is_profiled() const { return _build_profile != nullptr; }
+
+  /* Return BuildProfile of the map (including its slabs),
+   * throws std::runtime_error if it is not profiled. */
+  BuildProfile build_profile() const;
+
+  /* Write the map to the file in the versioned binary format
+   * with little-endian fixed size records of points, edges,
+   * trapezoids with indices of their neighbours and nodes of the search
+   * graph with indices of their children, so shared nodes are written once,
+   * along with the seed & order of the construction, so the loaded map
+   * is rebuilt by erasures like the saved one. */
+  void save(const std::string& path) const;
+
+  /* Read the map written by save with a single read of the file,
+   * nodes and trapezoids are created in a single block of the arena. */
+  static std::unique_ptr<TrapezoidalMap> load(const std::string& path);
+
+  // Return index of the ring which the point or the edge of the map is of,
+  // -1 for corners and edges of enclosing rectangle and free segments.
+  std::int64_t get_ring(const Point& point) const;
+  std::int64_t get_ring(const Edge& edge) const;
+
+  /* Return index of the innermost ring enclosing the trapezoid of the map:
+   * the border ring for trapezoids of the polygon interior, a hole
+   * for trapezoids inside of it and -1 for ones outside of the border.
+   * Free segments above the trapezoid are passed by searching
+   * for the trapezoids above them. */
+  std::int64_t get_ring(const Trapezoid& trapezoid) const;
+
+  /* Locate count points specified by interleaved x & y coordinates,
+   * writing Locator::Kind of the search result for each of them
+   * and the ring of the found point, edge or trapezoid
+   * into the corresponding output arrays. */
+  void locate_rings(const double* coordinates, std::size_t count,
+                    std::int64_t* rings, std::uint8_t* kinds) const;
+
+  /* Return label of the face containing the trapezoid of the map
+   * or -1 if faces are not labelled or it is outside of all segments. */
+  std::int64_t get_face(const Trapezoid& trapezoid) const;
+
+  /* Locate count points specified by interleaved x & y coordinates,
+   * writing Locator::Kind of the search result for each of them
+   * and the index of the found point, the index of the found segment
+   * or the label of the face of the found trapezoid
+   * into the corresponding output arrays. */
+  void locate_faces(const double* coordinates, std::size_t count,
+                    std::int64_t* values, std::uint8_t* kinds) const;
+
+  TrapezoidalMap(const TrapezoidalMap& other) = delete;
+  TrapezoidalMap& operator=(const TrapezoidalMap& other) = delete;
+
  private:
-  // Add the specified Edge to the search graph, returning true if successful.
-  bool add_edge(const Edge& edge);
+  // Point added by insertion along with its index and ring.
+  struct InsertedPoint : Point {
+    InsertedPoint(const Point& point, std::size_t index_, std::int64_t ring_)
+        : Point(point), index(index_), ring(ring_) {}
+
+    std::size_t index;
+    std::int64_t ring;
+  };
+
+  // Edge added by insertion along with its index and ring.
+  struct InsertedEdge : Edge {
+    InsertedEdge(const Point* left_, const Point* right_, std::size_t index_,
+                 std::int64_t ring_)
+        : Edge(left_, right_), index(index_), ring(ring_) {}
+
+    std::size_t index;
+    std::int64_t ring;
+  };
+
+  // Empty map to be filled by deserialize.
+  TrapezoidalMap();
+
+  /* Map of the specified edges of the other map sharing its points & edges
+   * clipped to the slab between the specified points,
+   * a null one stands for the side of the enclosing rectangle. */
+  TrapezoidalMap(const TrapezoidalMap& map,
+                 const std::vector<const Edge*>& edges, Order order,
+                 const Point* slab_left, const Point* slab_right);
+
+  /* Merge trapezoids of adjacent slabs maps which are separated
+   * by their boundary only and link the rest across it,
+   * taking trapezoids along left & right boundaries of each slab map. */
+  void stitch_slabs(const std::vector<std::vector<Trapezoid*>>& slabs_lefts,
+                    const std::vector<std::vector<Trapezoid*>>& slabs_rights);
+
+  // Encode the map in the format of save.
+  std::vector<char> serialize() const;
+
+  // Decode the map from the format of save.
+  static std::unique_ptr<TrapezoidalMap> deserialize(const char* data,
+                                                     std::size_t size);
+
+  // Build the search graph for the points.
+  void initialize(Order order);
+
+  // Check that rings offsets start with 0 and strictly increase.
+  void validate_rings_offsets() const;
+
+  // Add edges of rings to the search graph by the phased construction.
+  void insert_edges_phased();
+
+  /* Walk along the ring with points in the specified range through
+   * the trapezoids, setting starts of its edges which are not inserted
+   * to the nodes of trapezoids containing their left endpoints.
+   * Return false if fails, which can only happen for degenerate rings. */
+  bool trace_ring(std::size_t begin, std::size_t end,
+                  const std::vector<bool>& inserted,
+                  std::vector<const Node*>& starts) const;
+
+  // Set up points with corners of enclosing rectangle and edges of rings.
+  void initialize_edges();
+
+  // Set up points with corners of enclosing rectangle and segments edges.
+  void initialize_segments(const std::vector<Segment>& segments);
+
+  // Add corners of enclosing rectangle to points and its edges to edges.
+  void initialize_enclosing_rectangle();
+
+  // Allocate objects of the search graph counting them in the profile.
+  template <class... Args>
+  Trapezoid* create_trapezoid(Args&&... args);
+  template <class... Args>
+  Node* create_node(Args&&... args);
+
+  /* Create the search graph consisting of the enclosing rectangle
+   * (of the specified map for maps of slabs) clipped to the slab. */
+  Node* create_root();
+  Node* create_root(const TrapezoidalMap& map);
+
+  // Edges of the contour, i.e. all except the enclosing rectangle ones.
+  std::vector<const Edge*> inner_edges() const;
+
+  // Add the specified edges to the search graph in the specified Order.
+  void insert_edges(std::vector<const Edge*> edges, Order order);
+
+  /* Sort edges of BRIO rounds of the shuffled edges by the Hilbert curve
+   * order of their midpoints. */
+  static void sort_brio_rounds(std::vector<const Edge*>& edges);
+
+  /* Return point of the map's edges equal to the specified one
+   * or add a new one of the ring. */
+  const Point* insert_point(const Point& point, std::int64_t ring);
+
+  /* Add edge between the specified points of the map (returned
+   * by insert_point) of the ring to the search graph. */
+  std::size_t insert_ring_edge(const Point* start, const Point* end,
+                               std::int64_t ring, bool interior_below,
+                               const Faces& faces);
+
+  // Edge with the specified index among all of the map's ones.
+  const Edge& get_edge(std::size_t index) const;
+
+  // Remove the edge from the search graph.
+  void remove_edge(const Edge& edge);
+
+  /* Replace the node with the replacement in all of its parents,
+   * parents left with the replacement as both children are replaced
+   * by it as well and destroyed. */
+  void replace_node(Node* node, Node* replacement);
+
+  /* Create balanced tree of XNodes locating the specified consecutive
+   * trapezoids by their left points. */
+  Node* create_router(const std::vector<Trapezoid*>& trapezoids,
+                      std::size_t begin, std::size_t end);
+
+  // Build the search graph of the remaining edges from scratch.
+  void rebuild();
+
+  // Indices of the point or edge among all of the map's ones.
+  std::size_t get_index(const Point& point) const;
+  std::size_t get_index(const Edge& edge) const;
+
+  // Whether the point or edge is of the constructor rather than inserted.
+  bool is_initial(const Point& point) const;
+  bool is_initial(const Edge& edge) const;
+
+  /* Add the specified Edge to the search graph, returning true if successful,
+   * its left endpoint is searched from the start node if it is not null. */
+  bool add_edge(const Edge& edge, const Node* start = nullptr);
+
+  /* Add the specified Edge to the search graph replacing the trapezoids
+   * it intersects (found by find_trapezoids_intersecting_edge). */
+  void add_edge(const Edge& edge, const std::vector<Trapezoid*>& trapezoids);
+
+  // Endpoints of the edge clipped to the slab.
+  const Point* get_clipped_left(const Edge& edge) const;
+  const Point* get_clipped_right(const Edge& edge) const;
 
   /* Determine the trapezoids that the specified Edge intersects, returning
    * true if successful. */
-  bool find_trapezoids_intersecting_edge(const Edge& edge,
+  bool find_trapezoids_intersecting_edge(const Edge& edge, const Node& start,
                                          std::vector<Trapezoid*>& trapezoids);
 
   // All points plus corners of enclosing rectangle.
   std::vector<Point> _points;
+  // Indices of the first points of rings.
+  std::vector<std::size_t> _rings_offsets;
   // All edges plus bottom and top edges of enclosing rectangle.
   Edges _edges;
+  // Points & edges added after construction, deques keep addresses
+  // of the existing ones which are referred by edges, trapezoids & nodes.
+  std::deque<InsertedPoint> _inserted_points;
+  std::deque<InsertedEdge> _inserted_edges;
+  std::size_t _inserted_rings_count = 0;
+  // Seed of shuffles of edges by construction and rebuilding.
+  std::uint64_t _seed = DEFAULT_SEED;
+  // Order of insertion of edges by construction, reused by rebuilding.
+  Order _order = Order_Shuffle;
+  std::size_t _version = 0;
+  // Whether the edge with the same index is erased, empty if none are.
+  std::vector<bool> _erased_edges;
+  std::size_t _erased_edges_count = 0;
+  // Nodes of erased points & edges in the search graph.
+  std::size_t _erased_nodes_count = 0;
+  // Whether the interior of the polygon is below the edge with the same index
+  // in the ring of it (or in the enclosing rectangle).
+  std::vector<bool> _interiors_below;
+  // Labels of faces along inner edges, empty if not labelled.
+  std::vector<Faces> _faces;
+  /* Whether nodes of trapezoids replaced by add_edge are kept in place
+   * turned into the top nodes of their replacements, as by the phased
+   * construction, so nodes located before stay valid. */
+  bool _keep_replaced = false;
+  // Profile of insertions, null if the map is not profiled.
+  std::unique_ptr<BuildProfile> _build_profile;
+  // Owner of all nodes and trapezoids of the search graph.
+  Arena _arena;
+  // Boundaries of the slab of the map clipping its edges,
+  // null for the sides of the enclosing rectangle.
+  const Point* _slab_left = nullptr;
+  const Point* _slab_right = nullptr;
+  // Maps of vertical slabs of a parallel construction referring to
+  // points & edges of this map, their nodes and trapezoids are owned
+  // by their arenas, which are kept to hold the ones of this map.
+  std::vector<std::unique_ptr<TrapezoidalMap>> _slabs;
   // Root node of the trapezoid map search graph, owned.
   Node* _root;
+  // Lazily created locator of the search graph.
+  mutable std::unique_ptr<Locator> _locator;
+  mutable Mutex _mutex;
 };
 
 #endif
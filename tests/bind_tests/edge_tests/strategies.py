@@ -12,3 +12,4 @@ from tests.utils import (pack,
 points = strategies.builds(Point, floats, floats)
 sorted_points = to_pairs(points).filter(pack(ne)).map(sort_points)
 edges = sorted_points.map(pack(Edge))
+ratios = strategies.fractions(0, 1, max_denominator=1000)
@@ -1,3 +1,5 @@
+from fractions import Fraction
+
 from _seidel import (Edge,
                      Point)
 from hypothesis import given
@@ -14,3 +16,24 @@ def test_basic(edge: Edge, point: Point) -> None:
 def test_endpoints(edge: Edge) -> None:
     assert edge.orientation_with(edge.left) == 0
     assert edge.orientation_with(edge.right) == 0
+
+
+@given(strategies.edges, strategies.points)
+def test_exactness(edge: Edge, point: Point) -> None:
+    assert edge.orientation_with(point) == to_exact_orientation(edge, point)
+
+
+@given(strategies.edges, strategies.ratios)
+def test_near_degenerate(edge: Edge, ratio: Fraction) -> None:
+    point = Point(edge.left.x + float(ratio) * (edge.right.x - edge.left.x),
+                  edge.left.y + float(ratio) * (edge.right.y - edge.left.y))
+
+    assert edge.orientation_with(point) == to_exact_orientation(edge, point)
+
+
+def to_exact_orientation(edge: Edge, point: Point) -> int:
+    left_x, left_y = Fraction(edge.left.x), Fraction(edge.left.y)
+    cross_z = ((Fraction(point.x) - left_x) * (Fraction(edge.right.y) - left_y)
+               - (Fraction(point.y) - left_y) * (Fraction(edge.right.x)
+                                                 - left_x))
+    return (cross_z > 0) - (cross_z < 0)
@@ -0,0 +1,19 @@
+from _seidel import (Point,
+                     ThreadPool,
+                     TrapezoidalMap)
+from hypothesis import strategies
+from hypothesis_geometry import planar
+from hypothesis_geometry.hints import Contour
+
+from tests.strategies import (floats,
+                              to_pairs)
+
+
+def to_trapezoidal_map(raw: Contour) -> TrapezoidalMap:
+    return TrapezoidalMap([Point(x, y) for x, y in raw], False)
+
+
+trapezoidal_maps = planar.contours(floats).map(to_trapezoidal_map)
+coordinates_lists = strategies.lists(to_pairs(floats))
+thread_pools = strategies.integers(1, 4).map(ThreadPool)
+chunk_sizes = strategies.integers(1, 16)
@@ -0,0 +1,43 @@
+import os
+import tempfile
+from typing import (List,
+                    Tuple)
+
+import numpy
+import pytest
+from _seidel import (FrozenMap,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists)
+def test_basic(trapezoidal_map: TrapezoidalMap,
+               coordinates: List[Tuple[float, float]]) -> None:
+    frozen_map = trapezoidal_map.freeze()
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'map.bin')
+        frozen_map.save(path)
+        result = FrozenMap.attach(path)
+        indices, kinds = result.locate(points)
+        size = len(result)
+        # mapped files can not be removed on some platforms
+        del result
+
+    expected_indices, expected_kinds = frozen_map.locate(points)
+    assert size == len(frozen_map)
+    assert numpy.array_equal(indices, expected_indices)
+    assert numpy.array_equal(kinds, expected_kinds)
+
+
+def test_invalid() -> None:
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'map.bin')
+        with open(path, 'wb') as file:
+            file.write(b'SEIDELFM')
+
+        with pytest.raises(RuntimeError):
+            FrozenMap.attach(path)
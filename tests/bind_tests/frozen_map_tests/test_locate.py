@@ -0,0 +1,54 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+from _seidel import (ThreadPool,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists)
+def test_basic(trapezoidal_map: TrapezoidalMap,
+               coordinates: List[Tuple[float, float]]) -> None:
+    frozen_map = trapezoidal_map.freeze()
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    indices, kinds = frozen_map.locate(points)
+
+    expected_indices, expected_kinds = trapezoidal_map.locate(points)
+    assert len(frozen_map) == len(trapezoidal_map)
+    assert numpy.array_equal(indices, expected_indices)
+    assert numpy.array_equal(kinds, expected_kinds)
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists)
+def test_lockstep(trapezoidal_map: TrapezoidalMap,
+                  coordinates: List[Tuple[float, float]]) -> None:
+    frozen_map = trapezoidal_map.freeze()
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    indices, kinds = frozen_map.locate(points, lockstep=True)
+
+    expected_indices, expected_kinds = frozen_map.locate(points)
+    assert numpy.array_equal(indices, expected_indices)
+    assert numpy.array_equal(kinds, expected_kinds)
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists,
+       strategies.thread_pools, strategies.chunk_sizes)
+def test_pool(trapezoidal_map: TrapezoidalMap,
+              coordinates: List[Tuple[float, float]],
+              pool: ThreadPool,
+              chunk_size: int) -> None:
+    frozen_map = trapezoidal_map.freeze()
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    indices, kinds = frozen_map.locate(points,
+                                       pool=pool,
+                                       chunk_size=chunk_size)
+
+    expected_indices, expected_kinds = frozen_map.locate(points)
+    assert numpy.array_equal(indices, expected_indices)
+    assert numpy.array_equal(kinds, expected_kinds)
@@ -0,0 +1,24 @@
+from typing import List
+
+from _seidel import (Locator,
+                     Point,
+                     build_graph)
+from hypothesis import strategies
+from hypothesis_geometry import planar
+from hypothesis_geometry.hints import Contour
+
+from tests.strategies import (floats,
+                              to_pairs)
+
+
+def to_contour(raw: Contour) -> List[Point]:
+    return [Point(x, y) for x, y in raw]
+
+
+def to_locator(contour: List[Point]) -> Locator:
+    return Locator(build_graph(contour, False))
+
+
+contours = planar.contours(floats).map(to_contour)
+locators = contours.map(to_locator)
+coordinates_lists = strategies.lists(to_pairs(floats))
@@ -0,0 +1,52 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+from _seidel import (KIND_EDGE,
+                     KIND_POINT,
+                     KIND_TRAPEZOID,
+                     Leaf,
+                     Locator,
+                     Point,
+                     XNode,
+                     YNode,
+                     build_graph)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.locators, strategies.coordinates_lists)
+def test_basic(locator: Locator,
+               coordinates: List[Tuple[float, float]]) -> None:
+    result = locator.locate(numpy.array(coordinates,
+                                        dtype=float).reshape(-1, 2))
+
+    indices, kinds = result
+    assert indices.shape == kinds.shape == (len(coordinates),)
+    assert all(kind in (KIND_TRAPEZOID, KIND_POINT, KIND_EDGE)
+               for kind in kinds)
+    assert all(0 <= index < len(locator.trapezoids)
+               for index, kind in zip(indices, kinds)
+               if kind == KIND_TRAPEZOID)
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_search_point_equivalence(contour: List[Point],
+                                  coordinates: List[Tuple[float, float]]
+                                  ) -> None:
+    graph = build_graph(contour, False)
+    locator = Locator(graph)
+
+    indices, kinds = locator.locate(numpy.array(coordinates,
+                                                dtype=float).reshape(-1, 2))
+
+    for (x, y), index, kind in zip(coordinates, indices, kinds):
+        node = graph.search_point(Point(x, y))
+        if kind == KIND_TRAPEZOID:
+            assert isinstance(node, Leaf)
+            assert node.trapezoid == locator.trapezoids[index]
+        elif kind == KIND_POINT:
+            assert isinstance(node, XNode)
+        else:
+            assert isinstance(node, YNode)
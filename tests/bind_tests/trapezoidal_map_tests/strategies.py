@@ -0,0 +1,35 @@
+from typing import List
+
+from _seidel import (ORDER_BRIO,
+                     ORDER_INPUT,
+                     Point,
+                     ThreadPool,
+                     TrapezoidalMap)
+from hypothesis import strategies
+from hypothesis_geometry import planar
+from hypothesis_geometry.hints import Contour
+
+from tests.strategies import (floats,
+                              to_pairs)
+
+
+def to_contour(raw: Contour) -> List[Point]:
+    return [Point(x, y) for x, y in raw]
+
+
+def to_trapezoidal_map(contour: List[Point]) -> TrapezoidalMap:
+    return TrapezoidalMap(contour, False)
+
+
+contours = planar.contours(floats).map(to_contour)
+trapezoidal_maps = contours.map(to_trapezoidal_map)
+points = strategies.builds(Point, floats, floats)
+coordinates_lists = strategies.lists(to_pairs(floats))
+thread_pools = strategies.integers(1, 4).map(ThreadPool)
+chunk_sizes = strategies.integers(1, 16)
+slabs_counts = strategies.integers(0, 8)
+multiple_slabs_counts = strategies.integers(2, 8)
+seeds = strategies.integers(0, 2 ** 32)
+orders = strategies.integers(ORDER_INPUT, ORDER_BRIO)
+candidates_counts = strategies.integers(1, 4)
+booleans = strategies.booleans()
@@ -0,0 +1,41 @@
+from typing import List
+
+import pytest
+from _seidel import (Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.contours, strategies.seeds)
+def test_basic(contour: List[Point], seed: int) -> None:
+    result = TrapezoidalMap.build_phased(contour, seed=seed)
+
+    assert (result.root.to_proxy()
+            == TrapezoidalMap(contour, True, seed=seed).root.to_proxy())
+    assert len(result) == len(TrapezoidalMap(contour, True, seed=seed))
+
+
+@given(strategies.contours, strategies.seeds)
+def test_rings(contour: List[Point], seed: int) -> None:
+    result = TrapezoidalMap.build_phased([contour], seed=seed)
+
+    assert (result.root.to_proxy()
+            == TrapezoidalMap([contour], True, seed=seed).root.to_proxy())
+    assert result.rings_count == 1
+
+
+@given(strategies.contours, strategies.seeds)
+def test_profile(contour: List[Point], seed: int) -> None:
+    result = TrapezoidalMap.build_phased(contour, seed=seed, profile=True)
+
+    assert result.is_profiled
+    assert (len(result.build_profile()['crossed_trapezoids_counts'])
+            == len(contour))
+
+
+@given(strategies.contours)
+def test_invalid(contour: List[Point]) -> None:
+    with pytest.raises(ValueError):
+        TrapezoidalMap.build_phased([contour, []])
@@ -0,0 +1,36 @@
+from typing import List
+
+import pytest
+from _seidel import (Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.contours)
+def test_basic(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, True, profile=True)
+
+    result = trapezoidal_map.build_profile()
+
+    assert trapezoidal_map.is_profiled
+    assert result['search_edge']['calls'] == len(contour)
+    assert result['find_trapezoids']['calls'] == len(contour)
+    assert len(result['crossed_trapezoids_counts']) == len(contour)
+    assert all(count > 0 for count in result['crossed_trapezoids_counts'])
+    assert (result['replace_nodes']['calls']
+            <= int(result['crossed_trapezoids_counts'].sum()))
+    assert result['allocate_trapezoids']['calls'] > 0
+    assert result['allocate_nodes']['calls'] > 0
+    assert result['trapezoids_bytes'] > 0
+    assert result['nodes_bytes'] > 0
+    assert result['arena_bytes'] > 0
+    assert len(trapezoidal_map) == len(TrapezoidalMap(contour, True))
+
+
+@given(strategies.trapezoidal_maps)
+def test_disabled(trapezoidal_map: TrapezoidalMap) -> None:
+    assert not trapezoidal_map.is_profiled
+    with pytest.raises(RuntimeError):
+        trapezoidal_map.build_profile()
@@ -0,0 +1,53 @@
+from typing import List
+
+import pytest
+from _seidel import (Point,
+                     ThreadPool,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.contours, strategies.seeds,
+       strategies.candidates_counts)
+def test_basic(contour: List[Point],
+               seed: int,
+               candidates_count: int) -> None:
+    result = TrapezoidalMap.build_shallowest(contour, candidates_count,
+                                             seed=seed)
+
+    candidates = [TrapezoidalMap(contour, True, seed=seed + offset)
+                  for offset in range(candidates_count)]
+    assert result.stats().max_leaf_depth == min(
+            candidate.stats().max_leaf_depth for candidate in candidates)
+    assert len(result) == len(candidates[0])
+
+
+@given(strategies.contours, strategies.seeds,
+       strategies.candidates_counts, strategies.thread_pools)
+def test_pool(contour: List[Point],
+              seed: int,
+              candidates_count: int,
+              pool: ThreadPool) -> None:
+    result = TrapezoidalMap.build_shallowest(contour, candidates_count,
+                                             seed=seed, pool=pool)
+
+    assert (result.stats().max_leaf_depth
+            == TrapezoidalMap.build_shallowest(contour, candidates_count,
+                                               seed=seed)
+            .stats().max_leaf_depth)
+
+
+@given(strategies.contours, strategies.seeds)
+def test_seed(contour: List[Point], seed: int) -> None:
+    result = TrapezoidalMap(contour, True, seed=seed)
+
+    assert (result.root.to_proxy()
+            == TrapezoidalMap(contour, True, seed=seed).root.to_proxy())
+
+
+@given(strategies.contours)
+def test_invalid(contour: List[Point]) -> None:
+    with pytest.raises(ValueError):
+        TrapezoidalMap.build_shallowest(contour, 0)
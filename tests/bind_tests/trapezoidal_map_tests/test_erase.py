@@ -0,0 +1,72 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+import pytest
+from _seidel import (KIND_EDGE,
+                     KIND_TRAPEZOID,
+                     Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_basic(contour: List[Point],
+               coordinates: List[Tuple[float, float]]) -> None:
+    segments = [(index, (index + 1) % len(contour))
+                for index in range(len(contour))]
+    trapezoidal_map = TrapezoidalMap.from_segments(contour, segments, False)
+    points = numpy.array(coordinates + [(point.x, point.y)
+                                        for point in contour],
+                         dtype=float).reshape(-1, 2)
+
+    for segment in range(1, len(segments), 2):
+        trapezoidal_map.erase_edge(segment)
+
+    values, kinds = trapezoidal_map.locate_faces(points)
+    expected_values, expected_kinds = TrapezoidalMap.from_segments(
+            contour, segments[::2], False).locate_faces(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    for value, expected_value, kind in zip(values, expected_values, kinds):
+        assert int(value) == (2 * int(expected_value)
+                              if kind == KIND_EDGE
+                              else int(expected_value))
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_all(contour: List[Point],
+             coordinates: List[Tuple[float, float]]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    for segment in range(len(contour)):
+        trapezoidal_map.erase_edge(segment)
+
+    assert len(trapezoidal_map) == 1
+    values, kinds = trapezoidal_map.locate_faces(points)
+    assert all(kind == KIND_TRAPEZOID for kind in kinds)
+    assert all(int(value) == -1 for value in values)
+
+
+@given(strategies.contours)
+def test_invalid(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, False)
+    trapezoidal_map.erase_edge(0)
+
+    with pytest.raises(ValueError):
+        trapezoidal_map.erase_edge(0)
+    with pytest.raises(ValueError):
+        trapezoidal_map.erase_edge(len(contour))
+
+
+@given(strategies.contours)
+def test_invalidated_views(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, False)
+    root = trapezoidal_map.root
+
+    trapezoidal_map.erase_edge(0)
+
+    with pytest.raises(RuntimeError):
+        root.parents
@@ -0,0 +1,15 @@
+from _seidel import (LeafView,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps)
+def test_basic(trapezoidal_map: TrapezoidalMap) -> None:
+    result = list(trapezoidal_map)
+
+    assert len(result) == len(trapezoidal_map)
+    assert all(isinstance(trapezoid.trapezoid_node, LeafView)
+               and trapezoid.trapezoid_node.trapezoid == trapezoid
+               for trapezoid in result)
@@ -0,0 +1,90 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+from _seidel import (Point,
+                     ThreadPool,
+                     TrapezoidalMap,
+                     XNodeView,
+                     YNodeView,
+                     build_graph)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.contours)
+def test_basic(contour: List[Point]) -> None:
+    result = TrapezoidalMap(contour, False)
+
+    assert result.root.to_proxy() == build_graph(contour, False)
+
+
+@given(strategies.contours, strategies.booleans, strategies.thread_pools,
+       strategies.slabs_counts, strategies.points)
+def test_slabs(contour: List[Point],
+               shuffle: bool,
+               pool: ThreadPool,
+               slabs_count: int,
+               point: Point) -> None:
+    result = TrapezoidalMap(contour, shuffle, pool, slabs_count)
+
+    node = result.search_point(point)
+    expected_node = TrapezoidalMap(contour, shuffle).search_point(point)
+    assert type(node) is type(expected_node)
+    if isinstance(node, XNodeView):
+        assert node.point == expected_node.point
+    elif isinstance(node, YNodeView):
+        assert node.edge == expected_node.edge
+    else:
+        assert node.trapezoid.below == expected_node.trapezoid.below
+        assert node.trapezoid.above == expected_node.trapezoid.above
+
+
+@given(strategies.contours, strategies.booleans, strategies.thread_pools,
+       strategies.multiple_slabs_counts, strategies.coordinates_lists)
+def test_slabs_trapezoids(contour: List[Point],
+                          shuffle: bool,
+                          pool: ThreadPool,
+                          slabs_count: int,
+                          coordinates: List[Tuple[float, float]]) -> None:
+    result = TrapezoidalMap(contour, shuffle, pool, slabs_count)
+
+    expected = TrapezoidalMap(contour, shuffle)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+    assert len(result) == len(expected)
+    assert all(isinstance(result[index].left, Point)
+               for index in range(len(result)))
+    rings, kinds = result.locate_rings(points)
+    expected_rings, expected_kinds = expected.locate_rings(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    assert numpy.array_equal(rings, expected_rings)
+
+
+@given(strategies.contours, strategies.booleans, strategies.thread_pools,
+       strategies.multiple_slabs_counts, strategies.coordinates_lists)
+def test_slabs_erase(contour: List[Point],
+                     shuffle: bool,
+                     pool: ThreadPool,
+                     slabs_count: int,
+                     coordinates: List[Tuple[float, float]]) -> None:
+    result = TrapezoidalMap(contour, shuffle, pool, slabs_count)
+    expected = TrapezoidalMap(contour, shuffle)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    result.erase_edge(0)
+    expected.erase_edge(0)
+
+    assert len(result) == len(expected)
+    _, kinds = result.locate(points)
+    _, expected_kinds = expected.locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+
+
+@given(strategies.contours, strategies.booleans)
+def test_rings(contour: List[Point], shuffle: bool) -> None:
+    result = TrapezoidalMap([contour], shuffle)
+
+    assert result.rings_count == 1
+    assert result.root.to_proxy() == build_graph(contour, shuffle)
+    assert build_graph([contour], shuffle) == build_graph(contour, shuffle)
@@ -0,0 +1,143 @@
+import threading
+from typing import (List,
+                    Tuple)
+
+import numpy
+import pytest
+from _seidel import (KIND_POINT,
+                     Point,
+                     ThreadPool,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+from .test_locate_rings import to_enclosing_rectangle
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_contour(contour: List[Point],
+                 coordinates: List[Tuple[float, float]]) -> None:
+    border = to_enclosing_rectangle(contour)
+    trapezoidal_map = TrapezoidalMap(border, False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    result = trapezoidal_map.insert_contour(contour)
+
+    assert result == 1
+    assert trapezoidal_map.rings_count == 2
+    rings, kinds = trapezoidal_map.locate_rings(points)
+    expected_rings, expected_kinds = TrapezoidalMap(
+            [border, contour], False).locate_rings(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    assert numpy.array_equal(rings, expected_rings)
+
+
+@given(strategies.contours)
+def test_contour_points(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(to_enclosing_rectangle(contour), False)
+    points = numpy.array([(point.x, point.y) for point in contour],
+                         dtype=float).reshape(-1, 2)
+
+    trapezoidal_map.insert_contour(contour)
+
+    indices, kinds = trapezoidal_map.locate_faces(points)
+    assert all(kind == KIND_POINT for kind in kinds)
+    assert ([int(index) for index in indices]
+            == list(range(4, 4 + len(contour))))
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_edges(contour: List[Point],
+               coordinates: List[Tuple[float, float]]) -> None:
+    trapezoidal_map = TrapezoidalMap(to_enclosing_rectangle(contour), False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    indices = [trapezoidal_map.insert_edge(start, end)
+               for start, end in zip(contour, contour[1:] + contour[:1])]
+
+    assert indices == list(range(4, 4 + len(contour)))
+    _, kinds = trapezoidal_map.locate(points)
+    _, expected_kinds = TrapezoidalMap(
+            [to_enclosing_rectangle(contour), contour], False).locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_located_before(contour: List[Point],
+                        coordinates: List[Tuple[float, float]]) -> None:
+    border = to_enclosing_rectangle(contour)
+    trapezoidal_map = TrapezoidalMap(border, False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+    trapezoidal_map.locate(points)
+
+    trapezoidal_map.insert_contour(contour)
+
+    _, kinds = trapezoidal_map.locate(points)
+    expected_map = TrapezoidalMap([border, contour], False)
+    _, expected_kinds = expected_map.locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    assert len(trapezoidal_map) == len(expected_map)
+
+
+@given(strategies.contours, strategies.coordinates_lists,
+       strategies.thread_pools)
+def test_concurrent_locate(contour: List[Point],
+                           coordinates: List[Tuple[float, float]],
+                           pool: ThreadPool) -> None:
+    border = to_enclosing_rectangle(contour)
+    trapezoidal_map = TrapezoidalMap(border, False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+    inserter = threading.Thread(
+            target=lambda: [trapezoidal_map.insert_edge(start, end)
+                            for start, end in zip(contour,
+                                                  contour[1:] + contour[:1])])
+
+    inserter.start()
+    while inserter.is_alive():
+        trapezoidal_map.locate(points, pool, 1)
+        trapezoidal_map.locate_rings(points, pool, 1)
+    inserter.join()
+
+    _, kinds = trapezoidal_map.locate(points)
+    _, expected_kinds = TrapezoidalMap([border, contour], False).locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+
+
+@given(strategies.contours)
+def test_invalidated_views(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(to_enclosing_rectangle(contour), False)
+    root = trapezoidal_map.root
+    trapezoid = trapezoidal_map[0]
+
+    trapezoidal_map.insert_contour(contour)
+
+    with pytest.raises(RuntimeError):
+        root.parents
+    with pytest.raises(RuntimeError):
+        trapezoid.left
+    assert trapezoidal_map[0].left == trapezoidal_map[0].left
+
+
+@given(strategies.contours)
+def test_outside(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, False)
+    border = to_enclosing_rectangle(contour)
+
+    with pytest.raises(ValueError):
+        trapezoidal_map.insert_edge(Point(2 * border[0].x - border[2].x,
+                                          border[0].y),
+                                    border[0])
+
+
+@given(strategies.contours)
+def test_existing(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, False)
+    expected_root = trapezoidal_map.root.to_proxy()
+
+    with pytest.raises(ValueError):
+        trapezoidal_map.insert_edge(contour[0], contour[1])
+    with pytest.raises(ValueError):
+        trapezoidal_map.insert_contour(contour)
+
+    assert trapezoidal_map.rings_count == 1
+    assert trapezoidal_map.root.to_proxy() == expected_root
@@ -0,0 +1,42 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+from _seidel import (KIND_TRAPEZOID,
+                     LeafView,
+                     Point,
+                     ThreadPool,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists)
+def test_basic(trapezoidal_map: TrapezoidalMap,
+               coordinates: List[Tuple[float, float]]) -> None:
+    indices, kinds = trapezoidal_map.locate(
+            numpy.array(coordinates, dtype=float).reshape(-1, 2))
+
+    for (x, y), index, kind in zip(coordinates, indices, kinds):
+        node = trapezoidal_map.search_point(Point(x, y))
+        assert bool(kind == KIND_TRAPEZOID) is isinstance(node, LeafView)
+        if kind == KIND_TRAPEZOID:
+            assert trapezoidal_map[int(index)] == node.trapezoid
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists,
+       strategies.thread_pools, strategies.chunk_sizes)
+def test_pool(trapezoidal_map: TrapezoidalMap,
+              coordinates: List[Tuple[float, float]],
+              pool: ThreadPool,
+              chunk_size: int) -> None:
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    indices, kinds = trapezoidal_map.locate(points,
+                                            pool=pool,
+                                            chunk_size=chunk_size)
+
+    expected_indices, expected_kinds = trapezoidal_map.locate(points)
+    assert numpy.array_equal(indices, expected_indices)
+    assert numpy.array_equal(kinds, expected_kinds)
@@ -0,0 +1,61 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+from _seidel import (KIND_EDGE,
+                     KIND_POINT,
+                     KIND_TRAPEZOID,
+                     Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from tests.utils import (contour_contains,
+                         is_contour_counterclockwise)
+from . import strategies
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_basic(contour: List[Point],
+               coordinates: List[Tuple[float, float]]) -> None:
+    segments = [(index, (index + 1) % len(contour))
+                for index in range(len(contour))]
+    counterclockwise = is_contour_counterclockwise(contour)
+    faces = [(0, 1)
+             if is_forward(contour[start], contour[end]) is counterclockwise
+             else (1, 0)
+             for start, end in segments]
+    trapezoidal_map = TrapezoidalMap.from_segments(contour, segments, False,
+                                                   faces)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    values, kinds = trapezoidal_map.locate_faces(points)
+
+    for (x, y), value, kind in zip(coordinates, values, kinds):
+        if kind == KIND_TRAPEZOID:
+            assert int(value) == int(contour_contains(contour, x, y))
+        elif kind == KIND_POINT:
+            assert contour[int(value)] == Point(x, y)
+        else:
+            assert kind == KIND_EDGE
+            assert 0 <= int(value) < len(segments)
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_unlabelled(contour: List[Point],
+                    coordinates: List[Tuple[float, float]]) -> None:
+    segments = [(index, (index + 1) % len(contour))
+                for index in range(len(contour))]
+    trapezoidal_map = TrapezoidalMap.from_segments(contour, segments, False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    values, kinds = trapezoidal_map.locate_faces(points)
+
+    _, expected_kinds = TrapezoidalMap(contour, False).locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    assert all(int(value) == -1
+               for value, kind in zip(values, kinds)
+               if kind == KIND_TRAPEZOID)
+
+
+def is_forward(start: Point, end: Point) -> bool:
+    return (end.x, end.y) > (start.x, start.y)
@@ -0,0 +1,72 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+from _seidel import (KIND_TRAPEZOID,
+                     Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from tests.utils import contour_contains
+from . import strategies
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_basic(contour: List[Point],
+               coordinates: List[Tuple[float, float]]) -> None:
+    trapezoidal_map = TrapezoidalMap([contour], False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    rings, kinds = trapezoidal_map.locate_rings(points)
+
+    _, expected_kinds = trapezoidal_map.locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    for (x, y), ring, kind in zip(coordinates, rings, kinds):
+        if kind == KIND_TRAPEZOID:
+            assert int(ring) == (0 if contour_contains(contour, x, y) else -1)
+        else:
+            assert int(ring) == 0
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_hole(contour: List[Point],
+              coordinates: List[Tuple[float, float]]) -> None:
+    border = to_enclosing_rectangle(contour)
+    trapezoidal_map = TrapezoidalMap([border, contour], False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    rings, kinds = trapezoidal_map.locate_rings(points)
+
+    for (x, y), ring, kind in zip(coordinates, rings, kinds):
+        if kind == KIND_TRAPEZOID:
+            assert int(ring) == (1 if contour_contains(contour, x, y)
+                                 else (0 if contour_contains(border, x, y) else -1))
+
+
+@given(strategies.contours, strategies.coordinates_lists)
+def test_free_segment(contour: List[Point],
+                      coordinates: List[Tuple[float, float]]) -> None:
+    border = to_enclosing_rectangle(contour)
+    trapezoidal_map = TrapezoidalMap([border, contour], False)
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+    y = border[0].y + 0.5
+
+    trapezoidal_map.insert_edge(Point(border[0].x + 0.5, y),
+                                Point(border[1].x - 0.5, y))
+
+    rings, kinds = trapezoidal_map.locate_rings(points)
+    expected_rings, expected_kinds = TrapezoidalMap(
+            [border, contour], False).locate_rings(points)
+    for ring, kind, expected_ring, expected_kind in zip(
+            rings, kinds, expected_rings, expected_kinds):
+        if kind == expected_kind == KIND_TRAPEZOID:
+            assert int(ring) == int(expected_ring)
+
+
+def to_enclosing_rectangle(contour: List[Point]) -> List[Point]:
+    min_x, max_x = (min(point.x for point in contour) - 1,
+                    max(point.x for point in contour) + 1)
+    min_y, max_y = (min(point.y for point in contour) - 1,
+                    max(point.y for point in contour) + 1)
+    return [Point(min_x, min_y), Point(max_x, min_y), Point(max_x, max_y),
+            Point(min_x, max_y)]
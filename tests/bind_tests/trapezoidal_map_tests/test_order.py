@@ -0,0 +1,42 @@
+from typing import List
+
+import pytest
+from _seidel import (ORDER_BRIO,
+                     ORDER_INPUT,
+                     ORDER_SHUFFLE,
+                     Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.contours, strategies.seeds)
+def test_basic(contour: List[Point], seed: int) -> None:
+    result = TrapezoidalMap(contour, ORDER_BRIO, seed=seed)
+
+    assert len(result) == len(TrapezoidalMap(contour, True, seed=seed))
+    assert (result.root.to_proxy()
+            == TrapezoidalMap(contour, ORDER_BRIO, seed=seed).root.to_proxy())
+
+
+@given(strategies.contours, strategies.seeds)
+def test_flags(contour: List[Point], seed: int) -> None:
+    assert (TrapezoidalMap(contour, ORDER_INPUT, seed=seed).root.to_proxy()
+            == TrapezoidalMap(contour, False, seed=seed).root.to_proxy())
+    assert (TrapezoidalMap(contour, ORDER_SHUFFLE, seed=seed).root.to_proxy()
+            == TrapezoidalMap(contour, True, seed=seed).root.to_proxy())
+
+
+@given(strategies.contours, strategies.seeds)
+def test_rings(contour: List[Point], seed: int) -> None:
+    result = TrapezoidalMap([contour], ORDER_BRIO, seed=seed)
+
+    assert (result.root.to_proxy()
+            == TrapezoidalMap(contour, ORDER_BRIO, seed=seed).root.to_proxy())
+
+
+@given(strategies.contours)
+def test_invalid(contour: List[Point]) -> None:
+    with pytest.raises(ValueError):
+        TrapezoidalMap(contour, ORDER_BRIO + 1)
@@ -0,0 +1,38 @@
+from typing import (List,
+                    Tuple)
+
+import numpy
+import pytest
+from _seidel import TrapezoidalMap
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists)
+def test_basic(trapezoidal_map: TrapezoidalMap,
+               coordinates: List[Tuple[float, float]]) -> None:
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    result = trapezoidal_map.profile_search(points)
+
+    depths = result.x_nodes_steps + result.y_nodes_steps
+    assert len(depths) == len(coordinates)
+    assert numpy.array_equal(
+            result.depths_histogram,
+            numpy.bincount(depths.astype(numpy.int64),
+                           minlength=len(result.depths_histogram)))
+    assert len(result.visits_counts) == trapezoidal_map.freeze().nodes_count
+    assert int(result.visits_counts[0]) == len(coordinates)
+    summary = result.summary()
+    assert summary['queries_count'] == len(coordinates)
+    assert summary['x_nodes_steps'] == int(result.x_nodes_steps.sum())
+    assert summary['y_nodes_steps'] == int(result.y_nodes_steps.sum())
+    assert summary['visited_nodes_count'] == int(
+            numpy.count_nonzero(result.visits_counts))
+
+
+@given(strategies.trapezoidal_maps)
+def test_invalid(trapezoidal_map: TrapezoidalMap) -> None:
+    with pytest.raises(ValueError):
+        trapezoidal_map.profile_search(numpy.zeros((1, 3)))
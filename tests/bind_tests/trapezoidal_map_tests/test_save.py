@@ -0,0 +1,73 @@
+import os
+import tempfile
+from typing import (List,
+                    Tuple)
+
+import numpy
+import pytest
+from _seidel import (Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps, strategies.coordinates_lists)
+def test_basic(trapezoidal_map: TrapezoidalMap,
+               coordinates: List[Tuple[float, float]]) -> None:
+    points = numpy.array(coordinates, dtype=float).reshape(-1, 2)
+
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'map.bin')
+        trapezoidal_map.save(path)
+        result = TrapezoidalMap.load(path)
+
+    assert len(result) == len(trapezoidal_map)
+    assert result.root.to_proxy() == trapezoidal_map.root.to_proxy()
+    indices, kinds = result.locate(points)
+    expected_indices, expected_kinds = trapezoidal_map.locate(points)
+    assert numpy.array_equal(kinds, expected_kinds)
+    assert numpy.array_equal(indices, expected_indices)
+
+
+@given(strategies.contours)
+def test_updated(contour: List[Point]) -> None:
+    segments = [(index, (index + 1) % len(contour))
+                for index in range(len(contour))]
+    trapezoidal_map = TrapezoidalMap.from_segments(contour, segments, False)
+    trapezoidal_map.erase_edge(0)
+
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'map.bin')
+        trapezoidal_map.save(path)
+        result = TrapezoidalMap.load(path)
+    result.insert_edge(contour[0], contour[1])
+    trapezoidal_map.insert_edge(contour[0], contour[1])
+
+    assert result.root.to_proxy() == trapezoidal_map.root.to_proxy()
+
+
+@given(strategies.contours, strategies.orders, strategies.seeds)
+def test_rebuilt(contour: List[Point], order: int, seed: int) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, order, seed=seed)
+
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'map.bin')
+        trapezoidal_map.save(path)
+        result = TrapezoidalMap.load(path)
+    # Erased nodes outnumber the remaining edges, so both maps are rebuilt.
+    for segment in range(len(contour) // 2 + 1):
+        result.erase_edge(segment)
+        trapezoidal_map.erase_edge(segment)
+
+    assert result.root.to_proxy() == trapezoidal_map.root.to_proxy()
+
+
+def test_invalid() -> None:
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'map.bin')
+        with open(path, 'wb') as file:
+            file.write(b'SEIDELTM')
+
+        with pytest.raises(RuntimeError):
+            TrapezoidalMap.load(path)
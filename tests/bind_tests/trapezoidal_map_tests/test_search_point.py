@@ -0,0 +1,14 @@
+from _seidel import (Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps, strategies.points)
+def test_basic(trapezoidal_map: TrapezoidalMap, point: Point) -> None:
+    result = trapezoidal_map.search_point(point)
+
+    assert result == trapezoidal_map.root.search_point(point)
+    assert result.to_proxy() == (trapezoidal_map.root.to_proxy()
+                                 .search_point(point))
@@ -0,0 +1,36 @@
+from typing import List
+
+from _seidel import (Point,
+                     TrapezoidalMap)
+from hypothesis import given
+
+from . import strategies
+
+
+@given(strategies.trapezoidal_maps)
+def test_basic(trapezoidal_map: TrapezoidalMap) -> None:
+    result = trapezoidal_map.stats()
+
+    nodes_count = (result.x_nodes_count + result.y_nodes_count
+                   + result.leaves_count)
+    assert nodes_count == trapezoidal_map.freeze().nodes_count
+    assert result.leaves_count == len(trapezoidal_map)
+    assert result.parents_links_count == 2 * (result.x_nodes_count
+                                              + result.y_nodes_count)
+    assert 0 <= result.shared_nodes_count < nodes_count
+    assert 0 < result.average_leaf_depth <= result.max_leaf_depth
+    assert result.nodes_bytes % nodes_count == 0
+    assert result.trapezoids_bytes % result.leaves_count == 0
+
+
+@given(strategies.contours)
+def test_erased(contour: List[Point]) -> None:
+    trapezoidal_map = TrapezoidalMap(contour, False)
+    stats = trapezoidal_map.stats()
+
+    trapezoidal_map.erase_edge(0)
+
+    result = trapezoidal_map.stats()
+    assert result.leaves_count == len(trapezoidal_map)
+    assert result.points_bytes == stats.points_bytes
+    assert result.edges_bytes == stats.edges_bytes
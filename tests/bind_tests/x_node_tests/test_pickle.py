@@ -1,4 +1,11 @@
-from _seidel import XNode
+import pickle
+
+import pytest
+from _seidel import (Edge,
+                     Leaf,
+                     Point,
+                     XNode,
+                     YNode)
 from hypothesis import given
 
 from tests.utils import pickle_round_trip
@@ -8,3 +15,41 @@ from . import strategies
 @given(strategies.x_nodes)
 def test_round_trip(x_node: XNode) -> None:
     assert pickle_round_trip(x_node) == x_node
+
+
+@given(strategies.points, strategies.edges, strategies.leaves,
+       strategies.leaves)
+def test_sharing(point: Point,
+                 edge: Edge,
+                 leaf: Leaf,
+                 other_leaf: Leaf) -> None:
+    x_node = XNode(point, leaf, YNode(edge, other_leaf, leaf))
+
+    result = pickle_round_trip(x_node)
+
+    assert result == x_node
+    assert len(result.left.parents) == 2
+
+
+@pytest.mark.skipif(pickle.HIGHEST_PROTOCOL < 5,
+                    reason='out-of-band buffers need pickle protocol 5')
+@given(strategies.x_nodes)
+def test_out_of_band(x_node: XNode) -> None:
+    buffers = []
+
+    data = pickle.dumps(x_node,
+                        protocol=5,
+                        buffer_callback=buffers.append)
+
+    assert len(buffers) == 1
+    assert buffers[0].raw().nbytes == len(x_node.to_bytes())
+    assert pickle.loads(data,
+                        buffers=buffers) == x_node
+
+
+@given(strategies.x_nodes)
+def test_from_buffers(x_node: XNode) -> None:
+    data = x_node.to_bytes()
+
+    assert XNode.from_bytes(bytearray(data)) == x_node
+    assert XNode.from_bytes(memoryview(data)) == x_node
@@ -3,7 +3,8 @@ from hypothesis import given
 
 from seidel.trapezoidal_map import build_graph as ported_build_graph
 from tests.utils import (BoundPortedPointsListsPair,
-                         are_bound_ported_nodes_equal)
+                         are_bound_ported_nodes_equal,
+                         to_graph_nodes)
 from . import strategies
 
 
@@ -15,3 +16,16 @@ def test_basic(contours_pair: BoundPortedPointsListsPair) -> None:
                      ported_build_graph(ported_contour, False))
 
     assert are_bound_ported_nodes_equal(bound, ported)
+
+
+@given(strategies.contours_pairs)
+def test_sharing(contours_pair: BoundPortedPointsListsPair) -> None:
+    bound_contour, ported_contour = contours_pair
+
+    bound, ported = (bound_build_graph(bound_contour, False),
+                     ported_build_graph(ported_contour, False))
+
+    bound_nodes, ported_nodes = to_graph_nodes(bound), to_graph_nodes(ported)
+    assert len(bound_nodes) == len(ported_nodes)
+    assert ([len(node.parents) for node in bound_nodes]
+            == [len(node.parents) for node in ported_nodes])
@@ -1,5 +1,6 @@
 import pickle
 import sys
+from fractions import Fraction
 from functools import partial
 from typing import (Callable,
                     Iterable,
@@ -192,3 +193,42 @@ def node_to_children(node: AnyNode) -> Tuple[AnyNode, AnyNode]:
         return node.left, node.right
     else:
         return node.below, node.above
+
+
+def to_graph_nodes(root: AnyNode) -> List[AnyNode]:
+    result = []
+    visited_ids = set()
+    queue = [root]
+    while queue:
+        node = queue.pop()
+        if id(node) in visited_ids:
+            continue
+        visited_ids.add(id(node))
+        result.append(node)
+        if not isinstance(node, (BoundLeaf, PortedLeaf)):
+            queue.extend(reversed(node_to_children(node)))
+    return result
+
+
+def contour_contains(contour: Sequence[AnyPoint],
+                     x: Coordinate,
+                     y: Coordinate) -> bool:
+    """Exact even-odd test for the point strictly inside of the contour."""
+    x, y = Fraction(x), Fraction(y)
+    result = False
+    for index, start in enumerate(contour):
+        end = contour[index - 1]
+        start_x, start_y = Fraction(start.x), Fraction(start.y)
+        end_x, end_y = Fraction(end.x), Fraction(end.y)
+        if ((start_y > y) is not (end_y > y)
+                and x < (end_x - start_x) * (y - start_y) / (end_y - start_y)
+                + start_x):
+            result = not result
+    return result
+
+
+def is_contour_counterclockwise(contour: Sequence[AnyPoint]) -> bool:
+    return sum(Fraction(start.x) * Fraction(end.y)
+               - Fraction(end.x) * Fraction(start.y)
+               for start, end in zip(contour,
+                                     contour[1:] + contour[:1])) > 0